@@ -1,47 +1,194 @@
 #include <iostream>
 #include "alu.h"
+#include "stats.h"
 
 using namespace std;
 
-alu_t::alu_t(uint64_t *m_ticks) :
+alu_t::alu_t(uint64_t *m_ticks, bool m_debug, unsigned m_num_alus, unsigned m_num_muls,
+             unsigned m_num_divs, unsigned m_mul_depth, unsigned m_div_bits) :
     ticks(m_ticks),
-    exit_ticks(0),
-    run_inst(0) {
+    mul_depth(m_mul_depth),
+    div_bits(m_div_bits),
+    debug(m_debug) {
+    unsigned num_units[num_fu_types] = { m_num_alus, m_num_muls, m_num_divs };
+    for(unsigned i = 0; i < num_fu_types; i++) {
+        has_unit[i]     = num_units[i];
+        num_ops[i]      = 0;
+        busy_cycles[i]  = 0;
+        stall_cycles[i] = 0;
+        for(unsigned j = 0; j < num_units[i]; j++) {
+            fu_t unit;
+            unit.type         = fu_type(i);
+            unit.num_inflight = 0;
+            unit.issue_ticks  = 0;
+            unit.busy_end     = 0;
+            units.push_back(unit);
+        }
+    }
 }
 
 alu_t::~alu_t() {
+    for(size_t i = 0; i < entries.size(); i++) { delete entries[i].inst; }
 }
 
 // Get an instruction leaving the ALU. It may take multiple cycles for the ALU
-// to execute instructions depending on their types.
+// to execute instructions depending on their types. An instruction leaves
+// only after all older instructions have left.
 inst_t* alu_t::get_output() {
     inst_t *inst = 0;
     // The instruction has been staying enough number of ticks in the ALU.
-    if(*ticks >= exit_ticks) {
-        inst = run_inst;
-        run_inst = 0;
-        // Mark the rd value of instruction is ready for forwarding.
-        // The rd value of ld instruction becomes ready in the memory stage.
-#ifdef DATA_FWD
-        if(inst && (inst->rd_num > 0) && (inst->op != op_ld)) {
-            inst->rd_ready = true;
-        }
-#endif
+    if(entries.size() && (*ticks >= entries.front().exit_ticks)) {
+        inst = entries.front().inst;
+        release(entries.front());
+        entries.pop_front();
     }
     return inst;
 }
 
 // Is ALU free?
 bool alu_t::is_free() {
-    return !run_inst;
+    return entries.empty();
+}
+
+// Can an instruction be issued? A simple ALU and a divider take one
+// instruction at a time until it leaves the ALU, and a multiplier takes a
+// new instruction every cycle up to its pipeline depth.
+bool alu_t::can_run(const inst_t *m_inst) {
+    fu_type type = get_fu_type(m_inst);
+    for(size_t i = 0; i < units.size(); i++) {
+        const fu_t &unit = units[i];
+        if((unit.type == type) && (unit.issue_ticks != *ticks) &&
+           (unit.num_inflight < (type == fu_mul ? mul_depth : 1))) { return true; }
+    }
+    // The instruction waits for a unit.
+    stall_cycles[type]++;
+    return false;
 }
 
-// Execute an instruction.
+// Execute an instruction. It must be checked by can_run() first.
 void alu_t::run(inst_t *m_inst) {
-    // Set run_inst and its exit ticks that the run_inst can leave the ALU.
-    run_inst = m_inst;
-    exit_ticks = *ticks + m_inst->alu_latency - 1;
+    fu_type type = get_fu_type(m_inst);
+    unsigned i = 0;
+    while((units[i].type != type) || (units[i].issue_ticks == *ticks) ||
+          (units[i].num_inflight >= (type == fu_mul ? mul_depth : 1))) { i++; }
+    units[i].num_inflight++;
+    units[i].issue_ticks = *ticks;
+    num_ops[type]++;
+
+    // Set the instruction and its exit ticks that it can leave the ALU.
+    alu_entry_t entry;
+    entry.inst        = m_inst;
+    entry.unit        = i;
+    entry.issue_ticks = *ticks;
+    entry.exit_ticks  = *ticks + get_latency(m_inst) - 1;
+    // Instructions resolved by the functional model already have their results.
+    if(!m_inst->resolved && compute(m_inst) && debug) {
+        cout << *ticks << " : alu : divide-by-zero exception" << endl;
+    }
+
+    // The second instruction of a fused pair takes the rd value of the first
+    // one, and both instructions complete together.
+    inst_t *fused = m_inst->fused;
+    if(fused) {
+        if(fused->rs1_num == m_inst->rd_num) { fused->rs1_val = m_inst->rd_val; }
+        if(fused->rs2_num == m_inst->rd_num) { fused->rs2_val = m_inst->rd_val; }
+        if(fused->alu_latency > m_inst->alu_latency) {
+            entry.exit_ticks = *ticks + fused->alu_latency - 1;
+        }
+        if(!fused->resolved && compute(fused) && debug) {
+            cout << *ticks << " : alu : divide-by-zero exception" << endl;
+        }
+    }
+    // The instruction cannot leave before older ones.
+    if(entries.size() && (entry.exit_ticks < entries.back().exit_ticks)) {
+        entry.exit_ticks = entries.back().exit_ticks;
+    }
+    entries.push_back(entry);
+    if(debug && (entry.exit_ticks > *ticks)) {
+        cout << *ticks << " : alu : " << get_inst_str(m_inst, true) << endl;
+    }
+}
+
+// Get the unit type of an instruction. Without a multiplier or a divider,
+// the instruction runs in a simple ALU.
+fu_type alu_t::get_fu_type(const inst_t *m_inst) const {
+    switch(m_inst->op) {
+        case op_mul:  { return has_unit[fu_mul] ? fu_mul : fu_alu; }
+        case op_div:
+        case op_divu:
+        case op_rem:
+        case op_remu: { return has_unit[fu_div] ? fu_div : fu_alu; }
+        default:      { return fu_alu; }
+    }
+}
 
+// Get the latency of an instruction. A divider with variable latency
+// produces div_bits quotient bits per cycle, and it finishes early when the
+// dividend has few more significant bits than the divisor.
+unsigned alu_t::get_latency(const inst_t *m_inst) const {
+    if(!div_bits || (get_fu_type(m_inst) != fu_div)) { return m_inst->alu_latency; }
+    bool is_signed = (m_inst->op == op_div) || (m_inst->op == op_rem);
+    uint64_t dividend = m_inst->rs1_val, divisor = m_inst->rs2_val;
+    if(is_signed && (m_inst->rs1_val < 0)) { dividend = -dividend; }
+    if(is_signed && (m_inst->rs2_val < 0)) { divisor = -divisor; }
+    // Divide-by-zero and a dividend smaller than the divisor take one cycle.
+    if(!divisor || (dividend < divisor)) { return 1; }
+    unsigned quotient_bits = __builtin_clzll(divisor) - __builtin_clzll(dividend) + 1;
+    return 1 + (quotient_bits + div_bits - 1) / div_bits;
+}
+
+// Release the unit of an instruction leaving the ALU. The unit is busy from
+// the issue of the instruction until it leaves the ALU, and the cycles of
+// overlapping instructions in a pipelined unit are counted once.
+void alu_t::release(const alu_entry_t &m_entry) {
+    fu_t &unit = units[m_entry.unit];
+    unit.num_inflight--;
+    uint64_t start = m_entry.issue_ticks > unit.busy_end ? m_entry.issue_ticks : unit.busy_end + 1;
+    if(*ticks >= start) {
+        busy_cycles[unit.type] += *ticks - start + 1;
+        unit.busy_end = *ticks;
+    }
+}
+
+// Get the number of functional units.
+unsigned alu_t::num_units() const {
+    return units.size();
+}
+
+// Print functional unit stats.
+void alu_t::print_stats() {
+    static const char *fu_names[] = { "Simple ALU", "Multiplier", "Divider" };
+    cout << endl << "Functional unit stats:" << endl;
+    cout.precision(3);
+    for(unsigned i = 0; i < num_fu_types; i++) {
+        unsigned count = 0;
+        for(size_t j = 0; j < units.size(); j++) { count += (units[j].type == i); }
+        if(!count) { continue; }
+        cout << "    " << fu_names[i] << " x" << count << ":" << endl;
+        cout << "        Number of operations = " << num_ops[i] << endl;
+        cout << "        Utilization = " << fixed
+             << (*ticks ? double(busy_cycles[i]) / double(*ticks * count) : 0)
+             << " (" << busy_cycles[i] << " busy cycles)" << endl;
+        cout << "        Structural stall cycles = " << stall_cycles[i] << endl;
+    }
+    cout.precision(-1);
+}
+
+// Register functional unit stats.
+void alu_t::register_stats(stats_t *m_stats, const string &m_prefix) {
+    static const char *fu_prefixes[] = { "alu", "mul", "div" };
+    for(unsigned i = 0; i < num_fu_types; i++) {
+        if(!has_unit[i]) { continue; }
+        string prefix = m_prefix + "." + fu_prefixes[i];
+        m_stats->add_counter(prefix + ".ops", &num_ops[i], "Number of issued instructions");
+        m_stats->add_counter(prefix + ".busy", &busy_cycles[i], "Cycles that units are busy");
+        m_stats->add_counter(prefix + ".stalls", &stall_cycles[i],
+                             "Cycles that an instruction waits for a unit");
+    }
+}
+
+// Compute the result of an instruction, and return true on divide-by-zero.
+bool alu_t::compute(inst_t *m_inst) {
     // Divide-by-zero exception
     bool divide_by_zero = false;
 
@@ -94,20 +241,19 @@ void alu_t::run(inst_t *m_inst) {
         case op_jal:  { m_inst->rd_val = m_inst->pc + 4; break; }
         default:      { break; } // Nothing to do
     }
-#ifdef DEBUG
-    if(divide_by_zero) {
-        cout << *ticks << " : alu : divide-by-zero exception" << endl;
-    } 
-    if(exit_ticks > *ticks) {
-        cout << *ticks << " : alu : " << get_inst_str(run_inst, true) << endl;
-    }
-#endif
+    return divide_by_zero;
 }
 
-// Remove an instruction from the ALU.
-inst_t* alu_t::flush() {
-    inst_t *inst = run_inst;
-    run_inst = 0;
-    return inst;
+// Remove an instruction of a thread from the ALU. It is called until no
+// instruction of the thread is left.
+inst_t* alu_t::flush(unsigned m_tid) {
+    for(deque<alu_entry_t>::iterator it = entries.begin(); it != entries.end(); it++) {
+        if(it->inst->tid == m_tid) {
+            inst_t *inst = it->inst;
+            release(*it);
+            entries.erase(it);
+            return inst;
+        }
+    }
+    return 0;
 }
-
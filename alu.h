@@ -2,23 +2,76 @@
 #define __KITE_ALU_H__
 
 #include <cstdint>
+#include <deque>
+#include <string>
+#include <vector>
 #include "inst.h"
 
-// Arithmetic-logical unit (ALU)
+class stats_t;
+
+// Functional unit types
+enum fu_type {
+    fu_alu = 0,                 // Simple ALU (unpipelined)
+    fu_mul,                     // Multiplier (pipelined)
+    fu_div,                     // Iterative divider (unpipelined)
+    num_fu_types,
+};
+
+// Functional unit
+struct fu_t {
+    fu_type type;               // Unit type
+    unsigned num_inflight;      // Number of instructions in the unit
+    uint64_t issue_ticks;       // Clock ticks of the last issue
+    uint64_t busy_end;          // Last clock tick counted as busy
+};
+
+// Instruction in the ALU
+struct alu_entry_t {
+    inst_t *inst;               // Instruction
+    unsigned unit;              // Index of the functional unit
+    uint64_t issue_ticks;       // Clock ticks that the instruction was issued
+    uint64_t exit_ticks;        // Exit ticks that the instruction can leave the ALU
+};
+
+// Arithmetic-logical unit (ALU). It is a pool of functional units. A simple
+// ALU executes most instructions, and mul and div/rem go to a multiplier and
+// a divider if the pool has them. Instructions are issued one per cycle and
+// leave the ALU in program order.
 class alu_t {
 public:
-    alu_t(uint64_t *m_ticks);
+    alu_t(uint64_t *m_ticks, bool m_debug = false, unsigned m_num_alus = 1,
+          unsigned m_num_muls = 0, unsigned m_num_divs = 0, unsigned m_mul_depth = 1,
+          unsigned m_div_bits = 0);
     ~alu_t();
 
     inst_t* get_output();       // Get an instruction leaving the ALU.
     bool is_free();             // Is ALU free?
+    bool can_run(const inst_t *m_inst);    // Can an instruction be issued?
     void run(inst_t *m_inst);   // Execute an instruction.
-    inst_t* flush();            // Remove an instruction from the ALU.
+    inst_t* flush(unsigned m_tid);  // Remove an instruction of a thread from the ALU.
+    unsigned get_latency(const inst_t *m_inst) const;   // Get the latency of an instruction.
+    unsigned num_units() const; // Get the number of functional units.
+    void print_stats();         // Print functional unit stats.
+    void register_stats(stats_t *m_stats, const std::string &m_prefix);  // Register stats.
+    // Compute the result of an instruction, and return true on divide-by-zero.
+    static bool compute(inst_t *m_inst);
 
 private:
+    fu_type get_fu_type(const inst_t *m_inst) const;    // Get the unit type of an instruction.
+    void release(const alu_entry_t &m_entry);           // Release the unit of an instruction.
+
     uint64_t *ticks;            // Pointer to processor clock ticks
-    uint64_t exit_ticks;        // Exit ticks that a run_inst can leave the ALU
-    inst_t *run_inst;           // An instruction currently being executed
+    std::vector<fu_t> units;    // Functional units
+    std::deque<alu_entry_t> entries;        // Instructions in the ALU in program order
+    bool has_unit[num_fu_types];            // Does the pool have a unit of the type?
+    unsigned mul_depth;         // Pipeline depth of multipliers
+    unsigned div_bits;          // Quotient bits per divider cycle (0 for fixed latency)
+    bool debug;                 // Print debug messages?
+
+    // Stats per unit type
+    uint64_t num_ops[num_fu_types];         // Number of issued instructions
+    uint64_t busy_cycles[num_fu_types];     // Cycles that units are busy
+    uint64_t stall_cycles[num_fu_types];    // Cycles that an instruction waits for a unit
 };
 
 #endif
@@ -0,0 +1,84 @@
+#!/bin/bash
+# Kite host performance benchmark
+#
+# Runs each workload under bench/ with --host-stats, keeps the best of
+# BENCH_RUNS runs, and prints simulated instructions and cycles with host
+# simulation speed and peak memory. Results are written to bench/results.txt
+# and compared with bench/baseline.txt if it exists. A workload regresses if
+# its speed drops or its memory grows by more than BENCH_THRESHOLD percent,
+# and CHANGED marks a workload whose simulated instructions or cycles differ.
+#
+# Usage: bench/run.sh [--save]
+#   --save: save the results as the new baseline
+
+cd "$(dirname "$0")"
+kite=../kite
+runs=${BENCH_RUNS:-5}
+threshold=${BENCH_THRESHOLD:-10}
+results=results.txt
+baseline=baseline.txt
+
+if [ ! -x $kite ]; then
+    echo "Error: $kite not found" >&2
+    exit 1
+fi
+
+# Each result line is: workload insts cycles seconds KIPS cycles/s RSS(MB)
+: > $results
+for dir in */; do
+    name=${dir%/}
+    [ -f $name/program_code ] || continue
+    best=
+    for ((i = 0; i < runs; i++)); do
+        out=$(cd $name && ../$kite --host-stats program_code 2>&1)
+        if [ $? -ne 0 ]; then
+            echo "Error: $name failed" >&2
+            echo "$out" >&2
+            exit 1
+        fi
+        line=$(echo "$out" | awk -v name=$name '
+            /Total number of clock cycles/          { cycles = $NF }
+            /Total number of executed instructions/ { insts = $NF }
+            /Simulation time/                       { secs = $(NF-1) }
+            /Simulation speed/                      { kips = $(NF-1) }
+            /Simulated cycles per second/           { cps = $NF }
+            /Peak resident set size/                { rss = $(NF-1) }
+            END { print name, insts, cycles, secs, kips, cps, rss }')
+        # Keep the fastest run.
+        if [ -z "$best" ] || awk -v a="$line" -v b="$best" \
+            'BEGIN { split(a, x); split(b, y); exit !(x[5] > y[5]) }'; then
+            best=$line
+        fi
+    done
+    echo "$best" >> $results
+done
+
+awk -v threshold=$threshold -v baseline=$baseline '
+    BEGIN {
+        while((getline line < baseline) > 0) {
+            split(line, f); base[f[1]] = line
+        }
+        printf("%-10s %10s %10s %8s %10s %12s %8s  %s\n", "workload", "insts", "cycles",
+               "time(s)", "KIPS", "cycles/s", "RSS(MB)", "vs. baseline")
+    }
+    {
+        note = ""
+        if($1 in base) {
+            split(base[$1], b)
+            speed = b[5] ? ($5 - b[5]) * 100 / b[5] : 0
+            rss = b[7] ? ($7 - b[7]) * 100 / b[7] : 0
+            note = sprintf("speed %+.1f%%, RSS %+.1f%%", speed, rss)
+            if((speed < -threshold) || (rss > threshold)) { note = note " REGRESSION"; fail = 1 }
+            if(($2 != b[2]) || ($3 != b[3])) { note = note " CHANGED" }
+        }
+        printf("%-10s %10d %10d %8.3f %10.1f %12.0f %8.3f  %s\n", $1, $2, $3, $4, $5, $6, $7, note)
+    }
+    END { exit fail }' $results
+status=$?
+
+if [ "$1" = "--save" ]; then
+    cp $results $baseline
+    echo "Saved the baseline to bench/$baseline"
+    exit 0
+fi
+exit $status
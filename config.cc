@@ -0,0 +1,312 @@
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include "config.h"
+#include "stats.h"
+
+using namespace std;
+
+// Is a number a power of two?
+static bool is_pow2(uint64_t m_val) {
+    return m_val && !(m_val & (m_val - 1));
+}
+
+config_t::config_t() :
+    data_fwd(false),
+    br_pred(false),
+    debug(false),
+    fusion(false),
+    asm_cache(true),
+    mem_state("mem_state"),
+    reg_state("reg_state"),
+    bht_bits(0),
+    pht_bits(4),
+    hist_len(0),
+    btb_entries(16),
+    dcache_size(1024),
+    dcache_block_size(8),
+    dcache_ways(1),
+    victim_entries(0),
+    victim_latency(1),
+    memory_latency(0),
+    memory_queue_depth(16),
+    memory_bandwidth(0),
+    memory_in_order(true),
+    huge_pages(false),
+    dram(false),
+    dram_channels(1),
+    dram_ranks(1),
+    dram_banks(8),
+    dram_row_size(8192),
+    dram_open_page(true),
+    dram_t_rcd(14),
+    dram_t_cas(14),
+    dram_t_rp(14),
+    dram_t_ras(34),
+    dram_t_burst(4),
+    dram_t_refi(7800),
+    dram_t_rfc(350),
+    vm(false),
+    dtlb_entries(16),
+    dtlb_ways(4),
+    l2_tlb_entries(0),
+    l2_tlb_ways(8),
+    l2_tlb_latency(4),
+    walk_latency(1),
+    stack_dist(false),
+    stack_dist_set_bits(14),
+    stack_dist_ways(16),
+    fetch_policy("rr"),
+    func_sim(false),
+    func_sim_ring_entries(4096),
+    sb_entries(0),
+    sb_store_sets(true),
+    sb_ssit_entries(1024),
+    vp(false),
+    vp_type("stride"),
+    vp_entries(1024),
+    vp_confidence(3),
+    fu_alus(1),
+    fu_muls(0),
+    fu_divs(0),
+    fu_div_bits(0) {
+    for(unsigned i = 0; i < num_kite_opcodes; i++) { op_latency[i] = kite_op_latency[i]; }
+
+    // Parameter table
+    add("pipeline.data_fwd",      param_bool,   &data_fwd,           "Data forwarding");
+    add("pipeline.br_pred",       param_bool,   &br_pred,            "Branch prediction");
+    add("pipeline.debug",         param_bool,   &debug,              "Debug messages");
+    add("pipeline.fusion",        param_bool,   &fusion,             "Macro-op fusion");
+    add("program.asm_cache",      param_bool,   &asm_cache,          "Cache the assembled program");
+    add("program.mem_state",      param_string, &mem_state,          "Memory state file");
+    add("program.reg_state",      param_string, &reg_state,          "Register state file");
+    add("program.capture",        param_string, &capture,            "Execution trace file to capture");
+    add("program.replay",         param_string, &replay,             "Execution trace file to replay");
+    add("bp.bht_bits",            param_uint,   &bht_bits,           "Branch history table index bits");
+    add("bp.pht_bits",            param_uint,   &pht_bits,           "Pattern history table index bits");
+    add("bp.hist_len",            param_uint,   &hist_len,           "Branch history length");
+    add("bp.btb_entries",         param_uint,   &btb_entries,        "Number of branch target buffer entries");
+    add("dcache.size",            param_uint,   &dcache_size,        "Data cache size in bytes");
+    add("dcache.block_size",      param_uint,   &dcache_block_size,  "Data cache block size in bytes");
+    add("dcache.ways",            param_uint,   &dcache_ways,        "Data cache associativity");
+    add("dcache.victim_entries",  param_uint,   &victim_entries,     "Number of victim cache entries");
+    add("dcache.victim_latency",  param_uint,   &victim_latency,     "Victim cache hit latency");
+    add("memory.latency",         param_uint,   &memory_latency,     "Memory access latency");
+    add("memory.queue_depth",     param_uint,   &memory_queue_depth, "Memory request queue depth");
+    add("memory.bandwidth",       param_uint,   &memory_bandwidth,   "Memory bytes per cycle (0 for unlimited)");
+    add("memory.in_order",        param_bool,   &memory_in_order,    "Serve memory requests in order");
+    add("memory.huge_pages",      param_bool,   &huge_pages,         "Back host memory with huge pages");
+    add("dram.enabled",           param_bool,   &dram,               "DRAM backend");
+    add("dram.channels",          param_uint,   &dram_channels,      "Number of DRAM channels");
+    add("dram.ranks",             param_uint,   &dram_ranks,         "Number of ranks per channel");
+    add("dram.banks",             param_uint,   &dram_banks,         "Number of banks per rank");
+    add("dram.row_size",          param_uint,   &dram_row_size,      "DRAM row size in bytes");
+    add("dram.open_page",         param_bool,   &dram_open_page,     "Open-page policy");
+    add("dram.t_rcd",             param_uint,   &dram_t_rcd,         "Activate to column command delay");
+    add("dram.t_cas",             param_uint,   &dram_t_cas,         "Column command to data delay");
+    add("dram.t_rp",              param_uint,   &dram_t_rp,          "Precharge delay");
+    add("dram.t_ras",             param_uint,   &dram_t_ras,         "Activate to precharge delay");
+    add("dram.t_burst",           param_uint,   &dram_t_burst,       "Data burst duration");
+    add("dram.t_refi",            param_uint,   &dram_t_refi,        "Refresh interval (0 to disable)");
+    add("dram.t_rfc",             param_uint,   &dram_t_rfc,         "Refresh duration");
+    add("mmu.enabled",            param_bool,   &vm,                 "Virtual memory with an MMU");
+    add("mmu.dtlb_entries",       param_uint,   &dtlb_entries,       "Number of DTLB entries");
+    add("mmu.dtlb_ways",          param_uint,   &dtlb_ways,          "DTLB associativity");
+    add("mmu.l2_tlb_entries",     param_uint,   &l2_tlb_entries,     "Number of L2 TLB entries (0 to disable)");
+    add("mmu.l2_tlb_ways",        param_uint,   &l2_tlb_ways,        "L2 TLB associativity");
+    add("mmu.l2_tlb_latency",     param_uint,   &l2_tlb_latency,     "L2 TLB hit latency");
+    add("mmu.walk_latency",       param_uint,   &walk_latency,       "Page walker latency per level");
+    add("stack_dist.enabled",     param_bool,   &stack_dist,         "Stack distance analysis");
+    add("stack_dist.max_set_bits", param_uint,  &stack_dist_set_bits, "Maximum set index bits");
+    add("stack_dist.max_ways",    param_uint,   &stack_dist_ways,    "Maximum number of ways");
+    add("smt.fetch_policy",       param_string, &fetch_policy,       "Fetch policy (rr, icount, or switch_on_miss)");
+    add("func_sim.enabled",       param_bool,   &func_sim,           "Functional model on a separate thread");
+    add("func_sim.ring_entries",  param_uint,   &func_sim_ring_entries, "Number of ring buffer entries");
+    add("sb.entries",             param_uint,   &sb_entries,         "Number of store buffer entries (0 to disable)");
+    add("sb.store_sets",          param_bool,   &sb_store_sets,      "Predict memory dependences with store sets");
+    add("sb.ssit_entries",        param_uint,   &sb_ssit_entries,    "Number of store set ID table entries");
+    add("vp.enabled",             param_bool,   &vp,                 "Load value prediction");
+    add("vp.type",                param_string, &vp_type,            "Value predictor type (last, stride, or context)");
+    add("vp.entries",             param_uint,   &vp_entries,         "Number of value prediction table entries");
+    add("vp.confidence",          param_uint,   &vp_confidence,      "Correct predictions in a row to predict");
+    add("fu.alus",                param_uint,   &fu_alus,            "Number of simple ALUs");
+    add("fu.muls",                param_uint,   &fu_muls,            "Number of pipelined multipliers (0 to use ALUs)");
+    add("fu.divs",                param_uint,   &fu_divs,            "Number of iterative dividers (0 to use ALUs)");
+    add("fu.div_bits",            param_uint,   &fu_div_bits,        "Quotient bits per divider cycle (0 for fixed latency)");
+    for(unsigned i = 0; i < num_kite_opcodes; i++) {
+        add("alu.latency." + kite_opcode_str[i], param_uint, &op_latency[i],
+            "ALU latency of " + kite_opcode_str[i]);
+    }
+}
+
+config_t::~config_t() {
+}
+
+// Add a parameter to the table. The current value becomes the default.
+void config_t::add(const string &m_name, param_type m_type, void *m_value, const string &m_desc) {
+    param_t param;
+    param.name  = m_name;
+    param.desc  = m_desc;
+    param.type  = m_type;
+    param.value = m_value;
+    param.default_value = get(param);
+    params.push_back(param);
+}
+
+// Get a parameter value as a string.
+string config_t::get(const param_t &m_param) const {
+    switch(m_param.type) {
+        case param_uint:   { return to_string(*(uint64_t*)m_param.value); }
+        case param_bool:   { return *(bool*)m_param.value ? "true" : "false"; }
+        default:           { return *(string*)m_param.value; }
+    }
+}
+
+// Set a parameter from a string, and return false if the name is unknown.
+bool config_t::set(const string &m_name, const string &m_value) {
+    size_t i = 0;
+    while((i < params.size()) && (params[i].name != m_name)) { i++; }
+    if(i == params.size()) { return false; }
+
+    param_t &param = params[i];
+    bool valid = true;
+    if(param.type == param_uint) {
+        char *end = 0;
+        uint64_t value = strtoull(m_value.c_str(), &end, 10);
+        valid = m_value.size() && (m_value[0] != '-') && !*end;
+        if(valid) { *(uint64_t*)param.value = value; }
+    }
+    else if(param.type == param_bool) {
+        valid = (m_value == "true") || (m_value == "false") || (m_value == "1") || (m_value == "0");
+        if(valid) { *(bool*)param.value = (m_value == "true") || (m_value == "1"); }
+    }
+    else {
+        valid = m_value.size();
+        if(valid) { *(string*)param.value = m_value; }
+    }
+    if(!valid) {
+        cerr << "Error: invalid value " << m_value << " for parameter " << m_name << endl;
+        exit(1);
+    }
+    return true;
+}
+
+// Load a config file. Each line sets a parameter as "name = value", and
+// everything after # is a comment.
+void config_t::load(const char *m_file) {
+    fstream file_stream;
+    file_stream.open(m_file, fstream::in);
+    if(!file_stream.is_open()) {
+        cerr << "Error: failed to open " << m_file << endl;
+        exit(1);
+    }
+
+    string line;
+    size_t line_num = 0;
+    while(getline(file_stream, line)) {
+        line_num++;
+        // Crop everything after a comment symbol.
+        if(line.find_first_of("#") != string::npos) { line.erase(line.find_first_of("#")); }
+        // Erase all spaces.
+        line.erase(remove_if(line.begin(), line.end(), ::isspace), line.end());
+        // Skip blank lines.
+        if(!line.size()) { continue; }
+        size_t l = line.find_first_of("=");
+        if(l == string::npos) {
+            cerr << "Error: missing = at line #" << line_num << " of " << m_file << endl;
+            exit(1);
+        }
+        string name = line.substr(0, l);
+        if(!set(name, line.substr(l+1))) {
+            cerr << "Error: unknown parameter " << name
+                 << " at line #" << line_num << " of " << m_file << endl;
+            exit(1);
+        }
+    }
+    file_stream.close();
+}
+
+// Check if the parameters are valid.
+void config_t::validate() const {
+    const char *error = 0;
+    if(bht_bits > 30) { error = "bp.bht_bits must be at most 30"; }
+    else if(pht_bits + hist_len > 30) { error = "bp.pht_bits + bp.hist_len must be at most 30"; }
+    else if(!btb_entries) { error = "bp.btb_entries must be positive"; }
+    else if(!is_pow2(dcache_block_size) || (dcache_block_size < 8)) {
+        error = "dcache.block_size must be a power-of-two multiple of doubleword";
+    }
+    else if(!is_pow2(dcache_ways)) { error = "dcache.ways must be a power of two"; }
+    else if((dcache_size % (dcache_block_size * dcache_ways)) ||
+            !is_pow2(dcache_size / (dcache_block_size * dcache_ways))) {
+        error = "dcache.size must be a power-of-two number of sets of dcache.ways blocks";
+    }
+    else if(!memory_queue_depth) { error = "memory.queue_depth must be positive"; }
+    else if(!dram_channels || !dram_ranks || !dram_banks || !dram_row_size) {
+        error = "dram.channels, dram.ranks, dram.banks, and dram.row_size must be positive";
+    }
+    else if(!dtlb_ways || !dtlb_entries || (dtlb_entries % dtlb_ways)) {
+        error = "mmu.dtlb_entries must be a positive multiple of mmu.dtlb_ways";
+    }
+    else if(l2_tlb_entries && (!l2_tlb_ways || (l2_tlb_entries % l2_tlb_ways))) {
+        error = "mmu.l2_tlb_entries must be a multiple of mmu.l2_tlb_ways";
+    }
+    else if(stack_dist_set_bits > 20) { error = "stack_dist.max_set_bits must be at most 20"; }
+    else if(!is_pow2(stack_dist_ways)) { error = "stack_dist.max_ways must be a power of two"; }
+    else if(!is_pow2(func_sim_ring_entries)) { error = "func_sim.ring_entries must be a power of two"; }
+    else if((fetch_policy != "rr") && (fetch_policy != "icount") && (fetch_policy != "switch_on_miss")) {
+        error = "smt.fetch_policy must be rr, icount, or switch_on_miss";
+    }
+    else if(func_sim && replay.size()) { error = "func_sim.enabled cannot be used with program.replay"; }
+    else if(!is_pow2(sb_ssit_entries)) { error = "sb.ssit_entries must be a power of two"; }
+    // A load that ran ahead of a store is refetched, but a functional model
+    // or trace resolves each instruction only once.
+    else if(sb_entries && sb_store_sets && (func_sim || replay.size())) {
+        error = "sb.store_sets cannot be used with func_sim.enabled or program.replay";
+    }
+    else if((vp_type != "last") && (vp_type != "stride") && (vp_type != "context")) {
+        error = "vp.type must be last, stride, or context";
+    }
+    else if(!is_pow2(vp_entries)) { error = "vp.entries must be a power of two"; }
+    else if(!vp_confidence || (vp_confidence > 15)) { error = "vp.confidence must be between 1 and 15"; }
+    // Predicted values reach dependents only by forwarding, and a squash
+    // refetches instructions that a functional model or trace already resolved.
+    else if(vp && !data_fwd) { error = "vp.enabled requires pipeline.data_fwd"; }
+    else if(vp && (func_sim || replay.size())) {
+        error = "vp.enabled cannot be used with func_sim.enabled or program.replay";
+    }
+    else if(!fu_alus) { error = "fu.alus must be positive"; }
+    else if(fu_div_bits > 64) { error = "fu.div_bits must be at most 64"; }
+    // A replayed trace has no operand values for variable-latency division.
+    else if(fu_div_bits && replay.size()) { error = "fu.div_bits cannot be used with program.replay"; }
+    if(error) {
+        cerr << "Error: " << error << endl;
+        exit(1);
+    }
+    for(unsigned i = 0; i < num_kite_opcodes; i++) {
+        if(!op_latency[i] || (op_latency[i] > max_op_latency)) {
+            cerr << "Error: alu.latency." << kite_opcode_str[i] << " must be between 1 and "
+                 << max_op_latency << endl;
+            exit(1);
+        }
+    }
+}
+
+// Print parameters that differ from the defaults.
+void config_t::print_changes() const {
+    bool header = false;
+    for(size_t i = 0; i < params.size(); i++) {
+        string value = get(params[i]);
+        if(value == params[i].default_value) { continue; }
+        if(!header) { cout << endl << "Configuration changes:" << endl; header = true; }
+        cout << "    " << params[i].name << " = " << value
+             << " (default = " << params[i].default_value << ")" << endl;
+    }
+}
+
+// Register the effective values of all parameters.
+void config_t::register_stats(stats_t *m_stats, const string &m_prefix) const {
+    for(size_t i = 0; i < params.size(); i++) {
+        m_stats->add_param(m_prefix + "." + params[i].name, get(params[i]), params[i].desc);
+    }
+}
+
@@ -0,0 +1,127 @@
+#ifndef __KITE_CONFIG_H__
+#define __KITE_CONFIG_H__
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "defs.h"
+
+class stats_t;
+
+// Configuration parameter types
+enum param_type {
+    param_uint = 0,                         // Unsigned integer
+    param_bool,                             // true or false
+    param_string,                           // File path
+};
+
+// Configuration parameter
+struct param_t {
+    std::string name;                       // Hierarchical name (e.g., dcache.size)
+    std::string desc;                       // Description
+    param_type type;                        // Parameter type
+    void *value;                            // Pointer to the parameter value
+    std::string default_value;              // Default value as a string
+};
+
+// Simulation configuration. Parameters are read from a config file of
+// "name = value" lines, and command-line options override them. All
+// parameters are validated before the processor is created.
+class config_t {
+public:
+    config_t();
+    ~config_t();
+
+    void load(const char *m_file);          // Load a config file.
+    // Set a parameter from a string, and return false if the name is unknown.
+    bool set(const std::string &m_name, const std::string &m_value);
+    void validate() const;                  // Check if the parameters are valid.
+    void print_changes() const;             // Print parameters that differ from the defaults.
+    void register_stats(stats_t *m_stats, const std::string &m_prefix) const;  // Register parameters.
+
+    // Pipeline
+    bool data_fwd;                          // Data forwarding
+    bool br_pred;                           // Branch prediction
+    bool debug;                             // Debug messages
+    bool fusion;                            // Macro-op fusion
+    // Program and initial state
+    bool asm_cache;                         // Cache the assembled program.
+    std::string mem_state;                  // Memory state file
+    std::string reg_state;                  // Register state file
+    std::string capture;                    // Execution trace file to capture (optional)
+    std::string replay;                     // Execution trace file to replay (optional)
+    // Branch predictor
+    uint64_t bht_bits;                      // Branch history table index bits
+    uint64_t pht_bits;                      // Pattern history table index bits
+    uint64_t hist_len;                      // Branch history length
+    uint64_t btb_entries;                   // Number of branch target buffer entries
+    // Data cache
+    uint64_t dcache_size;                   // Cache size in bytes
+    uint64_t dcache_block_size;             // Block size in bytes
+    uint64_t dcache_ways;                   // Associativity
+    uint64_t victim_entries;                // Number of victim cache entries (0 to disable)
+    uint64_t victim_latency;                // Victim cache hit latency
+    // Memory
+    uint64_t memory_latency;                // Memory access latency
+    uint64_t memory_queue_depth;            // Memory request queue depth
+    uint64_t memory_bandwidth;              // Bytes per cycle (0 for unlimited)
+    bool memory_in_order;                   // Serve requests in order?
+    bool huge_pages;                        // Back host memory with huge pages?
+    // DRAM
+    bool dram;                              // DRAM backend
+    uint64_t dram_channels;                 // Number of channels
+    uint64_t dram_ranks;                    // Number of ranks per channel
+    uint64_t dram_banks;                    // Number of banks per rank
+    uint64_t dram_row_size;                 // Row size in bytes
+    bool dram_open_page;                    // Open-page policy? (closed-page if false)
+    uint64_t dram_t_rcd;                    // Activate to column command delay
+    uint64_t dram_t_cas;                    // Column command to data delay
+    uint64_t dram_t_rp;                     // Precharge delay
+    uint64_t dram_t_ras;                    // Activate to precharge delay
+    uint64_t dram_t_burst;                  // Data burst duration
+    uint64_t dram_t_refi;                   // Refresh interval
+    uint64_t dram_t_rfc;                    // Refresh duration
+    // Virtual memory
+    bool vm;                                // Virtual memory with an MMU
+    uint64_t dtlb_entries;                  // Number of DTLB entries
+    uint64_t dtlb_ways;                     // DTLB associativity
+    uint64_t l2_tlb_entries;                // Number of L2 TLB entries (0 to disable)
+    uint64_t l2_tlb_ways;                   // L2 TLB associativity
+    uint64_t l2_tlb_latency;                // L2 TLB hit latency
+    uint64_t walk_latency;                  // Page walker latency per level
+    // Stack distance analysis
+    bool stack_dist;                        // Stack distance analysis
+    uint64_t stack_dist_set_bits;           // Maximum set index bits
+    uint64_t stack_dist_ways;               // Maximum number of ways
+    // Multiple hardware threads
+    std::string fetch_policy;               // Fetch policy (rr, icount, or switch_on_miss)
+    // Functional-first simulation
+    bool func_sim;                          // Functional model on a separate thread
+    uint64_t func_sim_ring_entries;         // Number of ring buffer entries
+    // Store buffer
+    uint64_t sb_entries;                    // Number of store buffer entries (0 to disable)
+    bool sb_store_sets;                     // Predict memory dependences with store sets
+    uint64_t sb_ssit_entries;               // Number of store set ID table entries
+    // Load value prediction
+    bool vp;                                // Load value prediction
+    std::string vp_type;                    // Predictor type (last, stride, or context)
+    uint64_t vp_entries;                    // Number of prediction table entries
+    uint64_t vp_confidence;                 // Correct predictions in a row to predict
+    // Functional units
+    uint64_t fu_alus;                       // Number of simple ALUs
+    uint64_t fu_muls;                       // Number of pipelined multipliers (0 to use ALUs)
+    uint64_t fu_divs;                       // Number of iterative dividers (0 to use ALUs)
+    uint64_t fu_div_bits;                   // Quotient bits per divider cycle (0 for fixed latency)
+    // ALU
+    uint64_t op_latency[num_kite_opcodes];  // ALU latency per instruction
+
+private:
+    // Add a parameter to the table.
+    void add(const std::string &m_name, param_type m_type, void *m_value, const std::string &m_desc);
+    std::string get(const param_t &m_param) const;  // Get a parameter value as a string.
+
+    std::vector<param_t> params;            // Parameter table
+};
+
+#endif
+
@@ -1,14 +1,65 @@
 #include <cstdlib>
 #include <iostream>
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#endif
 #include "data_cache.h"
+#include "stats.h"
 
 using namespace std;
 
+// Compare up to 64 tags with a given tag, and return a bit vector of matching
+// ways. Tags are compared several ways at a time with SIMD instructions when
+// the host supports them, and the remainder is compared one by one.
+static inline uint64_t match_tags(const uint64_t *m_tags, uint64_t m_ways, uint64_t m_tag) {
+    uint64_t match = 0, w = 0;
+#if defined(__AVX2__)
+    __m256i key = _mm256_set1_epi64x(m_tag);
+    for(; w + 4 <= m_ways; w += 4) {
+        __m256i cmp = _mm256_cmpeq_epi64(_mm256_loadu_si256((const __m256i*)(m_tags + w)), key);
+        match |= uint64_t(_mm256_movemask_pd(_mm256_castsi256_pd(cmp))) << w;
+    }
+#elif defined(__SSE4_1__)
+    __m128i key = _mm_set1_epi64x(m_tag);
+    for(; w + 2 <= m_ways; w += 2) {
+        __m128i cmp = _mm_cmpeq_epi64(_mm_loadu_si128((const __m128i*)(m_tags + w)), key);
+        match |= uint64_t(_mm_movemask_pd(_mm_castsi128_pd(cmp))) << w;
+    }
+#elif defined(__SSE2__)
+    // SSE2 has no 64-bit compare. Both 32-bit halves of a tag must match.
+    __m128i key = _mm_set1_epi64x(m_tag);
+    for(; w + 2 <= m_ways; w += 2) {
+        __m128i cmp = _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i*)(m_tags + w)), key);
+        cmp = _mm_and_si128(cmp, _mm_shuffle_epi32(cmp, _MM_SHUFFLE(2, 3, 0, 1)));
+        match |= uint64_t(_mm_movemask_pd(_mm_castsi128_pd(cmp))) << w;
+    }
+#elif defined(__aarch64__)
+    uint64x2_t key = vdupq_n_u64(m_tag);
+    for(; w + 2 <= m_ways; w += 2) {
+        uint64x2_t cmp = vceqq_u64(vld1q_u64(m_tags + w), key);
+        match |= ((vgetq_lane_u64(cmp, 0) & 0b01) | (vgetq_lane_u64(cmp, 1) & 0b10)) << w;
+    }
+#endif
+    for(; w < m_ways; w++) { match |= uint64_t(m_tags[w] == m_tag) << w; }
+    return match;
+}
+
 data_cache_t::data_cache_t(uint64_t *m_ticks, uint64_t m_cache_size,
-                           uint64_t m_block_size, uint64_t m_ways) :
+                           uint64_t m_block_size, uint64_t m_ways,
+                           uint64_t m_victim_entries, uint64_t m_victim_latency,
+                           bool m_debug, bool m_replay) :
     memory(0),
+    victim_cache(0),
     ticks(m_ticks),
-    blocks(0),
+    walk_inst(0),
+    tags(0),
+    data(0),
+    valid(0),
+    dirty(0),
+    last_access(0),
+    valid_words(0),
     cache_size(m_cache_size),
     block_size(m_block_size),
     num_sets(0),
@@ -22,7 +73,18 @@ data_cache_t::data_cache_t(uint64_t *m_ticks, uint64_t m_cache_size,
     num_loads(0),
     num_stores(0),
     num_writebacks(0),
-    missed_inst(0) {
+    num_compulsory_misses(0),
+    num_capacity_misses(0),
+    num_conflict_misses(0),
+    num_walk_misses(0),
+    missed_inst(0),
+    miss_addr(0),
+    miss_pending(false),
+    victim_block(0),
+    victim_dirty(false),
+    victim_resp_ticks(0),
+    debug(m_debug),
+    replay(m_replay) {
     // Calculate the block offset.
     uint64_t val = block_size;
     while(!(val & 0b1)) {
@@ -59,15 +121,26 @@ data_cache_t::data_cache_t(uint64_t *m_ticks, uint64_t m_cache_size,
         exit(1);
     }
     
-    // Allocate cache blocks.
-    blocks = new block_t*[num_sets]();
-    for(uint64_t i = 0; i < num_sets; i++) { blocks[i] = new block_t[num_ways](); }
+    // Allocate cache blocks as contiguous per-set arrays.
+    valid_words = (num_ways + 63) >> 6;
+    tags        = new uint64_t[num_sets * num_ways]();
+    data        = new int64_t*[num_sets * num_ways]();
+    last_access = new uint64_t[num_sets * num_ways]();
+    valid       = new uint64_t[num_sets * valid_words]();
+    dirty       = new uint64_t[num_sets * valid_words]();
+
+    // Create a victim cache if enabled.
+    if(m_victim_entries) { victim_cache = new victim_cache_t(m_victim_entries, m_victim_latency); }
 }
 
 data_cache_t::~data_cache_t() {
     // Deallocate the cache blocks.
-    for(uint64_t i = 0; i < num_sets; i++) { delete [] blocks[i]; }
-    delete [] blocks;
+    delete [] tags;
+    delete [] data;
+    delete [] last_access;
+    delete [] valid;
+    delete [] dirty;
+    delete victim_cache;
 }
 
 // Connect to the lower-level memory.
@@ -89,29 +162,28 @@ void data_cache_t::read(inst_t *m_inst) {
     uint64_t set_index = (addr & set_mask) >> block_offset;
     uint64_t tag = addr >> set_offset;
 
-    // Check direct-mapped cache entry.
-    block_t *block = &blocks[set_index][0];
-    if(!block->valid || (block->tag != tag)) { block = 0; }
-    
-    if(block) { // Cache hit
+    // Look up the set for a matching way.
+    int64_t way = lookup(set_index, tag);
+    // Track a demand access that is not a replay of a missed access.
+    if(m_inst != missed_inst) { track_access(addr & ~block_mask, way < 0, m_inst); }
+
+    if(way >= 0) { // Cache hit
+        uint64_t block = set_index * num_ways + way;
         // Update the last access time.
-        block->last_access = *ticks;
-        // Read a doubleword in the block.
-        m_inst->rd_val = *(block->data + ((addr & block_mask) >> 3));
-#ifdef DATA_FWD
-        m_inst->rd_ready = true;
-#endif
+        last_access[block] = *ticks;
+        // Read a doubleword in the block. A replayed instruction has no data.
+        if(!(replay && m_inst->resolved)) { m_inst->rd_val = *(data[block] + ((addr & block_mask) >> 3)); }
         num_accesses++;
         num_loads++;
     }
     else { // Cache miss
         missed_inst = m_inst;
-        memory->load_block(addr & ~block_mask, block_size);
+        handle_miss(addr & ~block_mask);
         num_misses++;
-#ifdef DEBUG
-        cout << *ticks << " : cache miss : addr = " << addr
-             << " (tag = " << tag << ", set = " << set_index << ")" << endl;
-#endif
+        if(debug) {
+            cout << *ticks << " : cache miss : addr = " << addr
+                 << " (tag = " << tag << ", set = " << set_index << ")" << endl;
+        }
     }
 }
 
@@ -128,27 +200,29 @@ void data_cache_t::write(inst_t *m_inst) {
     uint64_t set_index = (addr & set_mask) >> block_offset;
     uint64_t tag = addr >> set_offset;
 
-    // Check the direct-mapped cache entry.
-    block_t *block = &blocks[set_index][0];
-    if(!block->valid || (block->tag != tag)) { block = 0; }
+    // Look up the set for a matching way.
+    int64_t way = lookup(set_index, tag);
+    // Track a demand access that is not a replay of a missed access.
+    if(m_inst != missed_inst) { track_access(addr & ~block_mask, way < 0, m_inst); }
 
-    if(block) { // Cache hit
+    if(way >= 0) { // Cache hit
+        uint64_t block = set_index * num_ways + way;
         // Update the last access time and dirty flag.
-        block->last_access = *ticks;
-        block->dirty = true;
-        // Write a doubleword in the block.
-        *(block->data + ((addr & block_mask) >> 3)) = m_inst->rs2_val;
+        last_access[block] = *ticks;
+        dirty[set_index * valid_words + (way >> 6)] |= uint64_t(1) << (way & 63);
+        // Write a doubleword in the block. A replayed instruction has no data.
+        if(!(replay && m_inst->resolved)) { *(data[block] + ((addr & block_mask) >> 3)) = m_inst->rs2_val; }
         num_accesses++;
         num_stores++;
     }
     else { // Cache miss
         missed_inst = m_inst;
-        memory->load_block(addr & ~block_mask, block_size);
+        handle_miss(addr & ~block_mask);
         num_misses++;
-#ifdef DEBUG
-        cout << *ticks << " : cache miss : addr = " << addr
-             << " (tag = " << tag << ", set = " << set_index << ")" << endl;
-#endif
+        if(debug) {
+            cout << *ticks << " : cache miss : addr = " << addr
+                 << " (tag = " << tag << ", set = " << set_index << ")" << endl;
+        }
     }
 }
 
@@ -160,30 +234,152 @@ void data_cache_t::handle_response(int64_t *m_data) {
     uint64_t tag = addr >> set_offset;
 
     // Block replacement
-    block_t *allocator = &blocks[set_index][0];
-    if(allocator->dirty) { num_writebacks++; }
-#ifdef DEBUG
-    if(allocator->valid) {
-        cout << *ticks << " : cache block eviction : addr = " << addr
-             << " (tag = " << tag << ", set = " << set_index << ")" << endl;
+    uint64_t way = get_victim(set_index);
+    uint64_t block = set_index * num_ways + way;
+    uint64_t flags = set_index * valid_words + (way >> 6);
+    uint64_t bit = uint64_t(1) << (way & 63);
+    if(valid[flags] & bit) {
+        uint64_t evict_addr = (tags[block] << set_offset) | (set_index << block_offset);
+        // An evicted block moves to the victim cache. Otherwise, a dirty block
+        // is written back to the memory.
+        if(victim_cache) {
+            uint64_t writeback_addr;
+            if(victim_cache->insert(evict_addr, data[block], dirty[flags] & bit, writeback_addr)) {
+                writeback_buffer.push_back(writeback_addr);
+                num_writebacks++;
+            }
+        }
+        else if(dirty[flags] & bit) {
+            writeback_buffer.push_back(evict_addr);
+            num_writebacks++;
+        }
+        if(debug) {
+            cout << *ticks << " : cache block eviction : addr = " << evict_addr
+                 << " (tag = " << tags[block] << ", set = " << set_index << ")" << endl;
+        }
     }
-#endif
-    // Place the missed block.
-    *allocator = block_t(tag, m_data, /* valid */ true);
+    // Place the missed block. A block swapped in from the victim cache
+    // retains its dirty flag.
+    tags[block] = tag;
+    data[block] = m_data;
+    last_access[block] = 0;
+    valid[flags] |= bit;
+    if(victim_block && victim_dirty) { dirty[flags] |= bit; }
+    else { dirty[flags] &= ~bit; }
 
     // Replay the cache access.
     if(missed_inst->op == op_ld) { read(missed_inst); }
     else { write(missed_inst); }
     // Clear the missed instruction so that the cache becomes free.
     missed_inst = 0;
+    victim_block = 0;
+}
+
+// Find a matching way in a set, and return -1 if no valid way matches.
+int64_t data_cache_t::lookup(uint64_t m_set, uint64_t m_tag) const {
+    const uint64_t *set_tags = &tags[m_set * num_ways];
+    const uint64_t *set_valid = &valid[m_set * valid_words];
+    for(uint64_t w = 0; w < num_ways; w += 64) {
+        uint64_t match = match_tags(set_tags + w, min(num_ways - w, uint64_t(64)), m_tag)
+                       & set_valid[w >> 6];
+        if(match) { return w + __builtin_ctzll(match); }
+    }
+    return -1;
+}
+
+// Select a way to replace. An invalid way is taken first, and otherwise the
+// least recently used way is evicted.
+uint64_t data_cache_t::get_victim(uint64_t m_set) const {
+    const uint64_t *set_valid = &valid[m_set * valid_words];
+    for(uint64_t i = 0; i < valid_words; i++) {
+        uint64_t invalid = ~set_valid[i];
+        if((i == valid_words-1) && (num_ways & 63)) { invalid &= (uint64_t(1) << (num_ways & 63)) - 1; }
+        if(invalid) { return (i << 6) + __builtin_ctzll(invalid); }
+    }
+    const uint64_t *set_last_access = &last_access[m_set * num_ways];
+    uint64_t way = 0;
+    for(uint64_t w = 1; w < num_ways; w++) {
+        if(set_last_access[w] < set_last_access[way]) { way = w; }
+    }
+    return way;
+}
+
+// Request a missed block. The victim cache is probed first, and the block is
+// loaded from the memory only if the victim cache misses.
+void data_cache_t::handle_miss(uint64_t m_addr) {
+    if(victim_cache && (victim_block = victim_cache->probe(m_addr, victim_dirty))) {
+        victim_resp_ticks = *ticks + victim_cache->get_latency();
+        if(debug) { cout << *ticks << " : victim cache hit : addr = " << m_addr << endl; }
+    }
+    else {
+        // The request is retried when the memory queue is full.
+        miss_addr = m_addr;
+        miss_pending = !memory->load_block(miss_addr, block_size, this);
+    }
+}
+
+// Update the shadow directory with a demand access, and classify a miss.
+void data_cache_t::track_access(uint64_t m_addr, bool m_miss, inst_t *m_inst) {
+    uint64_t block = m_addr >> block_offset;
+    uint64_t &touch_bits = touched[block >> 6];
+    bool first_touch = !((touch_bits >> (block & 63)) & 0b1);
+    touch_bits |= uint64_t(1) << (block & 63);
+
+    // Look up the fully-associative shadow directory.
+    unordered_map<uint64_t, list<uint64_t>::iterator>::iterator it = shadow_dir.find(block);
+    bool shadow_hit = (it != shadow_dir.end());
+
+    // Page table accesses are not classified or attributed to a PC.
+    if(m_miss && (m_inst == walk_inst)) { num_walk_misses++; }
+    else if(m_miss) {
+        if(first_touch)     { num_compulsory_misses++; }
+        else if(!shadow_hit) { num_capacity_misses++; }
+        else                { num_conflict_misses++; }
+        // Attribute the miss to the thread and PC of the memory instruction.
+        pair<uint64_t, string> &pc_miss = pc_misses[make_pair(m_inst->tid, m_inst->pc)];
+        if(!pc_miss.first) { pc_miss.second = get_inst_str(m_inst); }
+        pc_miss.first++;
+    }
+
+    // Move the block to the MRU position of the shadow directory.
+    if(shadow_hit) { shadow_lru.splice(shadow_lru.begin(), shadow_lru, it->second); }
+    else {
+        shadow_lru.push_front(block);
+        shadow_dir[block] = shadow_lru.begin();
+        // Evict the LRU block if the shadow directory exceeds the cache capacity.
+        if(shadow_lru.size() > num_sets * num_ways) {
+            shadow_dir.erase(shadow_lru.back());
+            shadow_lru.pop_back();
+        }
+    }
 }
 
 // Run data cache.
 bool data_cache_t::run() {
+    // Retry the miss request that the memory did not accept.
+    if(miss_pending) { miss_pending = !memory->load_block(miss_addr, block_size, this); }
     memory->run();          // Run the data memory.
+    // The victim cache responds after its hit latency.
+    if(victim_block && (*ticks >= victim_resp_ticks)) { handle_response(victim_block); }
+    // Drain dirty blocks to the memory.
+    while(writeback_buffer.size() && memory->store_block(writeback_buffer.front(), block_size)) {
+        writeback_buffer.pop_front();
+    }
     return missed_inst;     // Return true if the cache is busy.
 }
 
+// Set the load of the page walker to count its misses separately.
+void data_cache_t::set_walk_inst(const inst_t *m_inst) {
+    walk_inst = m_inst;
+}
+
+// Get the number of misses of a PC in a thread.
+uint64_t data_cache_t::get_pc_misses(uint64_t m_pc, unsigned m_tid) const {
+    map<pair<unsigned, uint64_t>, pair<uint64_t, string> >::const_iterator it =
+        pc_misses.find(make_pair(m_tid, m_pc));
+    return it == pc_misses.end() ? 0 : it->second.first;
+}
+
 // Print cache stats.
 void data_cache_t::print_stats() {
     cout << endl << "Data cache stats:" << endl;
@@ -194,6 +390,53 @@ void data_cache_t::print_stats() {
     cout << "    Miss rate = " << fixed
          << (num_accesses ? double(num_misses) / double(num_accesses) : 0)
          << " (" << num_misses << "/" << num_accesses << ")" << endl;
+    cout << "    Compulsory misses = " << num_compulsory_misses << endl;
+    cout << "    Capacity misses = " << num_capacity_misses << endl;
+    cout << "    Conflict misses = " << num_conflict_misses << endl;
+    if(walk_inst) { cout << "    Page walk misses = " << num_walk_misses << endl; }
     cout.precision(-1);
+    // Print the memory instructions with the most misses. The thread is
+    // printed if instructions of multiple threads missed.
+    if(pc_misses.size()) {
+        vector<pair<uint64_t, pair<unsigned, uint64_t> > > pcs;
+        bool multi_thread = false;
+        for(map<pair<unsigned, uint64_t>, pair<uint64_t, string> >::iterator it = pc_misses.begin();
+            it != pc_misses.end(); it++) {
+            pcs.push_back(make_pair(it->second.first, it->first));
+            multi_thread |= (it->first.first != 0);
+        }
+        sort(pcs.begin(), pcs.end(), greater<pair<uint64_t, pair<unsigned, uint64_t> > >());
+        cout << "    Misses by PC (top " << min(pcs.size(), size_t(10)) << "):" << endl;
+        for(size_t i = 0; (i < pcs.size()) && (i < 10); i++) {
+            cout << "        [";
+            if(multi_thread) { cout << "tid=" << pcs[i].second.first << ", "; }
+            cout << "pc=" << pcs[i].second.second << "] " << pc_misses[pcs[i].second].second
+                 << " = " << pcs[i].first << endl;
+        }
+    }
+    // Print victim cache stats.
+    if(victim_cache) { victim_cache->print_stats(); }
+}
+
+// Register cache stats.
+void data_cache_t::register_stats(stats_t *m_stats, const string &m_prefix) {
+    m_stats->add_counter(m_prefix + ".accesses", &num_accesses, "Number of accesses");
+    m_stats->add_counter(m_prefix + ".misses", &num_misses, "Number of misses");
+    m_stats->add_counter(m_prefix + ".loads", &num_loads, "Number of loads");
+    m_stats->add_counter(m_prefix + ".stores", &num_stores, "Number of stores");
+    m_stats->add_counter(m_prefix + ".writebacks", &num_writebacks, "Number of writebacks");
+    m_stats->add_counter(m_prefix + ".compulsory_misses", &num_compulsory_misses,
+                         "Number of compulsory misses");
+    m_stats->add_counter(m_prefix + ".capacity_misses", &num_capacity_misses,
+                         "Number of capacity misses");
+    m_stats->add_counter(m_prefix + ".conflict_misses", &num_conflict_misses,
+                         "Number of conflict misses");
+    if(walk_inst) {
+        m_stats->add_counter(m_prefix + ".walk_misses", &num_walk_misses,
+                             "Number of page table accesses that miss");
+    }
+    m_stats->add_formula(m_prefix + ".miss_rate", m_prefix + ".misses", m_prefix + ".accesses",
+                         "Miss rate");
+    if(victim_cache) { victim_cache->register_stats(m_stats, m_prefix + ".victim"); }
 }
 
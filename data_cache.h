@@ -1,49 +1,59 @@
 #ifndef __KITE_DATA_CACHE_H__
 #define __KITE_DATA_CACHE_H__
 
+#include <deque>
+#include <list>
+#include <map>
+#include <string>
+#include <unordered_map>
 #include "data_memory.h"
 #include "inst.h"
-
-// Cache block
-class block_t {
-public:
-    block_t() : tag(0), data(0), valid(false), dirty(false), last_access(0) {}
-    block_t(uint64_t m_tag, int64_t *m_data,
-            bool m_valid = false, bool m_dirty = false, uint64_t m_last_access = 0) :
-        tag(m_tag), data(m_data), valid(m_valid), dirty(m_dirty), last_access(m_last_access) {}
-    block_t(const block_t &b) : tag(b.tag), data(b.data),
-                                valid(b.valid), dirty(b.dirty), last_access(b.last_access) {}
-    ~block_t() {}
-    
-    // Comparison operators
-    bool operator==(const block_t &b) { return tag == b.tag; }
-    bool operator!=(const block_t &b) { return tag != b.tag; }
-    
-    uint64_t tag;                               // Block tag
-    int64_t *data;                              // Block data 
-    bool valid, dirty;                          // Valid, dirty flags
-    uint64_t last_access;                       // Last access cycle
-};
+#include "victim_cache.h"
 
 // Cache
 class data_cache_t {
 public:
     data_cache_t(uint64_t *m_ticks, uint64_t m_cache_size,
-                 uint64_t m_block_size = 8, uint64_t m_ways = 1);
+                 uint64_t m_block_size = 8, uint64_t m_ways = 1,
+                 uint64_t m_victim_entries = 0, uint64_t m_victim_latency = 1,
+                 bool m_debug = false, bool m_replay = false);
     ~data_cache_t();
 
     void connect(data_memory_t *m_memory);      // Connect to the lower-level memory.
+    // Set the load of the page walker to count its misses separately.
+    void set_walk_inst(const inst_t *m_inst);
     bool is_free() const;                       // Is cache free?
     void read(inst_t *m_inst);                  // Read data from cache.
     void write(inst_t *m_inst);                 // Write data in cache.
     void handle_response(int64_t *m_data);      // Handle a memory response.
     bool run();                                 // Run data cache, and return true when busy.
     void print_stats();                         // Print cache stats.
+    // Get the number of misses of a PC in a thread.
+    uint64_t get_pc_misses(uint64_t m_pc, unsigned m_tid = 0) const;
+    void register_stats(stats_t *m_stats, const std::string &m_prefix);   // Register stats.
 
 private:
+    int64_t lookup(uint64_t m_set, uint64_t m_tag) const;  // Find a matching way in a set.
+    uint64_t get_victim(uint64_t m_set) const;              // Select a way to replace.
+    void handle_miss(uint64_t m_addr);                      // Request a missed block.
+    // Update the shadow directory, and classify a miss.
+    void track_access(uint64_t m_addr, bool m_miss, inst_t *m_inst);
+
     data_memory_t *memory;                      // Pointer to the lower-level memory
+    victim_cache_t *victim_cache;               // Victim cache (optional)
     uint64_t *ticks;                            // Pointer to processor clock ticks
-    block_t** blocks;                           // Cache blocks
+    const inst_t *walk_inst;                    // Load of the page walker (optional)
+
+    // Cache blocks are laid out as contiguous per-set arrays (structure of
+    // arrays) so that a tag lookup scans a single run of memory. Tags, data
+    // pointers, and last access cycles have num_ways entries per set, and
+    // valid and dirty flags are bit vectors of valid_words per set.
+    uint64_t *tags;                             // Block tags
+    int64_t **data;                             // Block data
+    uint64_t *valid;                            // Valid bit vectors
+    uint64_t *dirty;                            // Dirty bit vectors
+    uint64_t *last_access;                      // Last access cycles
+    uint64_t valid_words;                       // Number of 64-bit flag words per set
 
     uint64_t cache_size;                        // Cache size in bytes
     uint64_t block_size;                        // Block size in bytes
@@ -59,9 +69,30 @@ private:
     uint64_t num_loads;                         // Number of loads
     uint64_t num_stores;                        // Number of stores
     uint64_t num_writebacks;                    // Number of writebacks
+    uint64_t num_compulsory_misses;             // Number of compulsory misses
+    uint64_t num_capacity_misses;               // Number of capacity misses
+    uint64_t num_conflict_misses;               // Number of conflict misses
+    uint64_t num_walk_misses;                   // Number of page walk misses
+
+    // Misses are classified with a fully-associative LRU directory of the same
+    // capacity and a bitmap of blocks that have ever been touched. A miss on
+    // a block never touched is compulsory. Otherwise, it is a capacity miss if
+    // the fully-associative directory misses too, or a conflict miss if not.
+    std::list<uint64_t> shadow_lru;             // Shadow LRU stack of block addresses (MRU first)
+    std::unordered_map<uint64_t, std::list<uint64_t>::iterator> shadow_dir;  // Shadow directory
+    std::unordered_map<uint64_t, uint64_t> touched;        // First-touch bitmap of blocks
+    // Misses per thread and PC
+    std::map<std::pair<unsigned, uint64_t>, std::pair<uint64_t, std::string> > pc_misses;
 
     inst_t *missed_inst;                        // Missed memory instruction
+    uint64_t miss_addr;                         // Block address of the miss
+    bool miss_pending;                          // Is the miss request waiting for the memory?
+    std::deque<uint64_t> writeback_buffer;      // Dirty blocks waiting to be written back
+    int64_t *victim_block;                      // Block data supplied by the victim cache
+    bool victim_dirty;                          // Dirty flag of the victim cache block
+    uint64_t victim_resp_ticks;                 // Response ticks of the victim cache
+    bool debug;                                 // Print debug messages?
+    bool replay;                                // Are resolved instructions replayed without data?
 };
 
-#endif 
-
+#endif
@@ -1,97 +1,237 @@
 #include <cstring>
 #include <fstream>
+#include <fcntl.h>
 #include <iostream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #include "defs.h"
 #include "data_cache.h"
 #include "data_memory.h"
+#include "dram.h"
+#include "mmu.h"
+#include "stats.h"
 
 using namespace std;
 
-data_memory_t::data_memory_t(uint64_t *m_ticks, uint64_t m_memory_size,
-                             uint64_t m_code_segment_size, uint64_t m_latency) :
-    cache(0),
+data_memory_t::data_memory_t(uint64_t *m_ticks, uint64_t m_code_segment_size,
+                             uint64_t m_latency, uint64_t m_page_table_base, bool m_huge_pages,
+                             const char *m_mem_state, uint64_t m_queue_depth,
+                             uint64_t m_bandwidth, bool m_in_order) :
+    dram(0),
     ticks(m_ticks),
-    memory(0),
-    accessed(0),
-    memory_size(m_memory_size),
+    last_page_num(-1),
+    last_page(0),
+    chunk_used(mem_chunk_size),
+    huge_pages(m_huge_pages),
     code_segment_size(m_code_segment_size),
-    num_dwords(m_memory_size>>3),
+    page_table_base(m_page_table_base),
+    page_table_top(m_page_table_base),
+    queue_depth(m_queue_depth),
+    bandwidth(m_bandwidth),
+    in_order(m_in_order),
     latency(m_latency),
-    resp_ticks(0),
-    req_block(0) {
-    // Check if the memory size is a multiple of doubleword.
-    if(memory_size & 0b111) {
-        cerr << "Error: memory size must be a multiple of doubleword" << endl;
+    next_id(0),
+    bus_free(0),
+    num_reads(0),
+    num_writes(0),
+    num_rejects(0),
+    queueing_delay(0),
+    bus_busy(0),
+    bytes_transferred(0) {
+    if(!queue_depth) {
+        cerr << "Error: memory request queue depth must be positive" << endl;
         exit(1);
     }
-    if(memory_size < min_memory_size) {
-        cerr << "Error: memory size has to be at least " << (min_memory_size>>10) << "KB" << endl;
-        exit(1);
-    }
-
-    // Allocate a memory space in unit of doublewords.
-    memory = new int64_t[num_dwords];
-    accessed = new bool[num_dwords];
-
-    // Zero the memory space.
-    memset(memory,   0, num_dwords * sizeof(int64_t));
-    memset(accessed, 0, num_dwords * sizeof(bool));
-
     // Load initial memory state.
-    load_mem_state();
+    if(m_mem_state) { load_mem_state(m_mem_state); }
 }
 
 data_memory_t::~data_memory_t() {
-    // Deallocate the memory space.
-    delete [] memory;
-    delete [] accessed;
+    // Deallocate the host memory chunks.
+    for(size_t i = 0; i < chunks.size(); i++) { munmap(chunks[i], mem_chunk_size); }
+    // Unmap the memory images.
+    for(size_t i = 0; i < images.size(); i++) { munmap(images[i].first, images[i].second); }
 }
 
-// Connect to the upper-level cache.
-void data_memory_t::connect(data_cache_t *m_cache) { cache = m_cache; }
+// Connect to a DRAM backend.
+void data_memory_t::connect(dram_t *m_dram) { dram = m_dram; }
 
 // Run the data memory.
 void data_memory_t::run() {
-    if(req_block && (*ticks >= resp_ticks)) {
-        // Invoke the upper-level cache to handle a returned response.
-        cache->handle_response(req_block);
-        // Clear the requested block.
-        req_block = 0;
+    // Mark the requests that the DRAM has completed.
+    if(dram) {
+        dram->run();
+        uint64_t id;
+        while(dram->retire(id)) {
+            for(list<mem_request_t>::iterator it = requests.begin(); it != requests.end(); it++) {
+                if(it->id == id) { it->ready = *ticks; break; }
+            }
+        }
+    }
+
+    // Schedule data transfers of completed requests. In-order delivery holds
+    // back a request until all older requests are scheduled.
+    for(list<mem_request_t>::iterator it = requests.begin(); it != requests.end(); it++) {
+        if(it->done != uint64_t(-1)) { continue; }
+        if(it->ready > *ticks) {
+            if(in_order) { break; }
+            continue;
+        }
+        uint64_t start = bus_free > *ticks ? bus_free : *ticks;
+        uint64_t cycles = bandwidth ? (it->size + bandwidth - 1) / bandwidth : 0;
+        it->done = start + cycles;
+        bus_free = it->done;
+        queueing_delay += start - it->ready;
+        bus_busy += cycles;
+        bytes_transferred += it->size;
+    }
+
+    // Deliver transferred requests, and invoke the requesters of reads.
+    for(list<mem_request_t>::iterator it = requests.begin(); it != requests.end();) {
+        if(it->done > *ticks) {
+            if(in_order) { break; }
+            it++; continue;
+        }
+        mem_request_t req = *it;
+        it = requests.erase(it);
+        if(!req.write) { req.requester->handle_response(req.data); }
     }
 }
 
-// Load a memory block.
-void data_memory_t::load_block(uint64_t m_addr, uint64_t m_block_size) {
+// Request a memory block for a cache.
+bool data_memory_t::load_block(uint64_t m_addr, uint64_t m_block_size, data_cache_t *m_requester) {
     // Check the doubleword alignment of memory address.
     if(m_addr & 0b111) {
         cerr << "Error: invalid alignment of memory address " << m_addr << endl;
         exit(1);
     }
-    // Check if the requested block size is within memory space.
-    if((m_addr+m_block_size) > memory_size) {
-        cerr << "Error: memory address " << m_addr << " is out of bounds" << endl;
+    // Check if the requested block is within a page.
+    if(((m_addr & ((1<<mem_page_bits)-1)) + m_block_size) > (1<<mem_page_bits)) {
+        cerr << "Error: memory block at address " << m_addr << " crosses a page boundary" << endl;
         exit(1);
     }
     else if(m_addr < code_segment_size) {
         cerr << "Error: memory address " << m_addr << " is in the code segment" << endl;
         exit(1);
     }
+    // Reject the request if the queue is full.
+    if(requests.size() >= queue_depth) { num_rejects++; return false; }
 
     // Mark all doublewords in the requested block are accessed.
-    for(uint64_t i = 0; i < m_block_size>>3; i++) { accessed[(m_addr>>3)+i] = true; }
-    // Set pointer to a requested block.
-    req_block = &memory[m_addr>>3];
-    // Set time ticks to respond to the cache later.
-    resp_ticks = *ticks + latency;
+    mem_page_t *page = get_page(m_addr);
+    uint64_t offset = (m_addr & ((1<<mem_page_bits)-1)) >> 3;
+    for(uint64_t i = offset; i < offset+(m_block_size>>3); i++) {
+        page->touched[i>>6] |= uint64_t(1) << (i&63);
+    }
+    enqueue(m_addr, m_block_size, false, m_requester, &page->data[offset]);
+    num_reads++;
+    return true;
+}
+
+// Write back a memory block. Block data are written in place by the cache,
+// so a writeback only occupies the memory.
+bool data_memory_t::store_block(uint64_t m_addr, uint64_t m_block_size) {
+    if(requests.size() >= queue_depth) { num_rejects++; return false; }
+    enqueue(m_addr, m_block_size, true, 0, 0);
+    num_writes++;
+    return true;
+}
+
+// Enqueue a memory request. Without a DRAM backend, the access completes
+// after a fixed latency.
+void data_memory_t::enqueue(uint64_t m_addr, uint64_t m_size, bool m_write,
+                            data_cache_t *m_requester, int64_t *m_data) {
+    mem_request_t req;
+    req.id        = next_id++;
+    req.addr      = m_addr;
+    req.size      = m_size;
+    req.write     = m_write;
+    req.requester = m_requester;
+    req.data      = m_data;
+    req.arrival   = *ticks;
+    req.ready     = dram ? uint64_t(-1) : *ticks + latency;
+    req.done      = uint64_t(-1);
+    requests.push_back(req);
+    if(dram) { dram->request(req.id, m_addr, m_write); }
+}
+
+// Read a doubleword without timing.
+int64_t data_memory_t::read_dword(uint64_t m_addr) {
+    return get_page(m_addr)->data[(m_addr & ((1<<mem_page_bits)-1)) >> 3];
+}
+
+// Write a doubleword without timing.
+void data_memory_t::write_dword(uint64_t m_addr, int64_t m_data) {
+    get_page(m_addr)->data[(m_addr & ((1<<mem_page_bits)-1)) >> 3] = m_data;
+}
+
+// Allocate a zeroed page frame in the page table region.
+uint64_t data_memory_t::alloc_page_frame() {
+    uint64_t frame = page_table_top;
+    page_table_top += 1<<page_offset_bits;
+    return frame;
+}
+
+// Get a page, and allocate it on first touch.
+mem_page_t* data_memory_t::get_page(uint64_t m_addr) {
+    uint64_t page_num = m_addr >> mem_page_bits;
+    if(page_num != last_page_num) {
+        mem_page_t &page = pages[page_num];
+        if(!page.data) { page.data = alloc_page_data(); }
+        last_page_num = page_num;
+        last_page = &page;
+    }
+    return last_page;
+}
+
+// Allocate host memory for a page. Pages are carved out of chunks of
+// anonymous memory, which the host zeroes lazily on first touch.
+int64_t* data_memory_t::alloc_page_data() {
+    if(chunk_used == mem_chunk_size) {
+        // Map twice the chunk size to align the chunk to a huge page boundary.
+        char *ptr = (char*)mmap(0, mem_chunk_size<<1, PROT_READ | PROT_WRITE,
+                                MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if(ptr == MAP_FAILED) {
+            cerr << "Error: failed to allocate host memory" << endl;
+            exit(1);
+        }
+        char *chunk = (char*)((uint64_t(ptr) + mem_chunk_size - 1) & ~(mem_chunk_size - 1));
+        if(chunk > ptr) { munmap(ptr, chunk - ptr); }
+        munmap(chunk + mem_chunk_size, ptr + mem_chunk_size - chunk);
+#ifdef MADV_HUGEPAGE
+        if(huge_pages) { madvise(chunk, mem_chunk_size, MADV_HUGEPAGE); }
+#endif
+        chunks.push_back((int64_t*)chunk);
+        chunk_used = 0;
+    }
+    int64_t *data = chunks.back() + (chunk_used >> 3);
+    chunk_used += 1<<mem_page_bits;
+    return data;
 }
 
 // Load initial memory state.
-void data_memory_t::load_mem_state() {
+void data_memory_t::load_mem_state(const char *m_file, uint64_t m_base) {
+    // Map the memory state file if it is a binary image.
+    int fd = open(m_file, O_RDONLY);
+    if(fd < 0) {
+        cerr << "Error: failed to open " << m_file << endl;
+        exit(1);
+    }
+    char magic[sizeof(mem_image_magic)];
+    if((read(fd, magic, sizeof(magic)) == sizeof(magic)) &&
+       !memcmp(magic, mem_image_magic, sizeof(magic))) {
+        load_mem_image(fd, m_file, m_base);
+        close(fd);
+        return;
+    }
+    close(fd);
+
     // Open a memory state file.
     fstream file_stream;
-    file_stream.open("mem_state", fstream::in);
+    file_stream.open(m_file, fstream::in);
     if(!file_stream.is_open()) {
-        cerr << "Error: failed to open mem_state" << endl;
+        cerr << "Error: failed to open " << m_file << endl;
         exit(1);
     }
 
@@ -117,31 +257,25 @@ void data_memory_t::load_mem_state() {
            !addr_str.length()    || !data_str.length()) {
             cerr << "Error: invalid memory address and/or data " << addr_str
                  << " = " << data_str << " at line #" << line_num
-                 << " of mem_state" << endl;
+                 << " of " << m_file << endl;
             exit(1);
         }
 
         // Convert the memory address and data string to numbers.
-        uint64_t memory_addr = get_imm(addr_str); 
+        uint64_t memory_addr = m_base + get_imm(addr_str);
         int64_t memory_data = get_imm(data_str);
         // Check the alignment of memory address.
         if(memory_addr & 0b111) {
-            cerr << "Error: invalid alignment of memory address " << memory_addr
-                 << " at line #" << line_num << " of mem_state" << endl;
-            exit(1);
-        }
-        // The memory address goes out of bounds.
-        if((memory_addr+8) > memory_size) {
-            cerr << "Error: memory address " << memory_addr << " is out of bounds"
-                 << " at line #" << line_num << " of mem_state" << endl;
+            cerr << "Error: invalid alignment of memory address " << memory_addr - m_base
+                 << " at line #" << line_num << " of " << m_file << endl;
             exit(1);
         }
         // Check if multiple different values are defined at the same memory address.
-        int64_t &dword = memory[memory_addr>>3];
+        int64_t &dword = get_page(memory_addr)->data[(memory_addr & ((1<<mem_page_bits)-1)) >> 3];
         if(dword && (dword != memory_data)) {
-            cerr << "Error: memory address " << memory_addr
+            cerr << "Error: memory address " << memory_addr - m_base
                  << " has multiple values defined at line # " << line_num
-                 << " of mem_state" << endl;
+                 << " of " << m_file << endl;
             exit(1);
         }
         // Store the memory data.
@@ -152,11 +286,183 @@ void data_memory_t::load_mem_state() {
     file_stream.close();
 }
 
-// Print memory state.
-void data_memory_t::print_state() const {
+// Map a binary memory image. Segment pages point directly into a private
+// mapping of the file, so the host reads them in on demand, and stores
+// of the simulated program copy the pages without modifying the file.
+void data_memory_t::load_mem_image(int m_fd, const char *m_file, uint64_t m_base) {
+#if __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+    cerr << "Error: binary memory image " << m_file << " requires a little-endian host" << endl;
+    exit(1);
+#endif
+    struct stat file_stat;
+    if(fstat(m_fd, &file_stat) || (uint64_t(file_stat.st_size) < sizeof(mem_image_header_t))) {
+        cerr << "Error: truncated memory image " << m_file << endl;
+        exit(1);
+    }
+    uint64_t file_size = file_stat.st_size;
+    char *image = (char*)mmap(0, file_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, m_fd, 0);
+    if(image == MAP_FAILED) {
+        cerr << "Error: failed to map memory image " << m_file << endl;
+        exit(1);
+    }
+    images.push_back(make_pair((void*)image, file_size));
+
+    // Check the image header.
+    const mem_image_header_t *header = (const mem_image_header_t*)image;
+    if(header->version != mem_image_version) {
+        cerr << "Error: unsupported version " << header->version
+             << " of memory image " << m_file << endl;
+        exit(1);
+    }
+    if(header->num_segments > (file_size - sizeof(mem_image_header_t)) / sizeof(mem_image_segment_t)) {
+        cerr << "Error: truncated segment table of memory image " << m_file << endl;
+        exit(1);
+    }
+
+    // Map the pages of each segment.
+    const mem_image_segment_t *segments = (const mem_image_segment_t*)(header + 1);
+    uint64_t page_mask = (1<<mem_page_bits) - 1;
+    for(uint64_t s = 0; s < header->num_segments; s++) {
+        const mem_image_segment_t &segment = segments[s];
+        if((segment.addr & page_mask) || (segment.size & page_mask) || (segment.offset & page_mask)) {
+            cerr << "Error: invalid alignment of segment #" << s
+                 << " of memory image " << m_file << endl;
+            exit(1);
+        }
+        if((segment.offset > file_size) || (segment.size > file_size - segment.offset)) {
+            cerr << "Error: segment #" << s << " exceeds the size of memory image " << m_file << endl;
+            exit(1);
+        }
+        for(uint64_t p = 0; p < (segment.size >> mem_page_bits); p++) {
+            mem_page_t &page = pages[((m_base + segment.addr) >> mem_page_bits) + p];
+            if(page.data) {
+                cerr << "Error: memory address " << (m_base + segment.addr + (p << mem_page_bits))
+                     << " has multiple values defined in segment #" << s
+                     << " of memory image " << m_file << endl;
+                exit(1);
+            }
+            page.data = (int64_t*)(image + segment.offset + (p << mem_page_bits));
+        }
+    }
+}
+
+// Save memory state as a binary image. Consecutive pages are merged into
+// a segment, and segment data are placed at page-aligned file offsets.
+void data_memory_t::save_mem_image(const char *m_file) const {
+    // Sort the page numbers to build segments in address order.
+    vector<uint64_t> page_nums;
+    for(unordered_map<uint64_t, mem_page_t>::const_iterator it = pages.begin();
+        it != pages.end(); it++) {
+        // Page tables are not part of the program data.
+        if(page_table_base && ((it->first << mem_page_bits) >= page_table_base)) { continue; }
+        page_nums.push_back(it->first);
+    }
+    sort(page_nums.begin(), page_nums.end());
+
+    vector<mem_image_segment_t> segments;
+    for(size_t p = 0; p < page_nums.size(); p++) {
+        if(!segments.size() ||
+           ((segments.back().addr + segments.back().size) != (page_nums[p] << mem_page_bits))) {
+            mem_image_segment_t segment = { page_nums[p] << mem_page_bits, 0, 0 };
+            segments.push_back(segment);
+        }
+        segments.back().size += 1<<mem_page_bits;
+    }
+    // Segment data start at the first page boundary after the segment table.
+    uint64_t page_mask = (1<<mem_page_bits) - 1;
+    uint64_t offset = (sizeof(mem_image_header_t) + segments.size()*sizeof(mem_image_segment_t)
+                    + page_mask) & ~page_mask;
+    for(size_t s = 0; s < segments.size(); s++) {
+        segments[s].offset = offset;
+        offset += segments[s].size;
+    }
+
+    fstream file_stream;
+    file_stream.open(m_file, fstream::out | fstream::binary | fstream::trunc);
+    if(!file_stream.is_open()) {
+        cerr << "Error: failed to open " << m_file << endl;
+        exit(1);
+    }
+    mem_image_header_t header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, mem_image_magic, sizeof(mem_image_magic));
+    header.version = mem_image_version;
+    header.num_segments = segments.size();
+    file_stream.write((const char*)&header, sizeof(header));
+    file_stream.write((const char*)segments.data(), segments.size()*sizeof(mem_image_segment_t));
+    // Pad the segment table to a page boundary.
+    vector<char> padding(segments.size() ? segments[0].offset - uint64_t(file_stream.tellp()) : 0, 0);
+    file_stream.write(padding.data(), padding.size());
+    for(size_t p = 0; p < page_nums.size(); p++) {
+        file_stream.write((const char*)pages.find(page_nums[p])->second.data, 1<<mem_page_bits);
+    }
+    if(!file_stream) {
+        cerr << "Error: failed to write " << m_file << endl;
+        exit(1);
+    }
+    file_stream.close();
+}
+
+// Print memory controller stats.
+void data_memory_t::print_stats() {
+    uint64_t num_requests = num_reads + num_writes;
+    cout << endl << "Memory controller stats:" << endl;
+    cout << "    Request queue depth = " << queue_depth << " ("
+         << (in_order ? "in-order" : "out-of-order") << " delivery)" << endl;
+    cout << "    Number of read requests = " << num_reads << endl;
+    cout << "    Number of write requests = " << num_writes << endl;
+    cout << "    Number of rejected requests = " << num_rejects << endl;
+    cout.precision(3);
+    cout << "    Average queueing delay = " << fixed
+         << (num_requests ? double(queueing_delay) / double(num_requests) : 0)
+         << " cycles" << endl;
+    cout << "    Bandwidth = " << fixed
+         << (*ticks ? double(bytes_transferred) / double(*ticks) : 0) << " bytes/cycle";
+    if(bandwidth) {
+        cout << " (utilization " << (*ticks ? double(bus_busy) / double(*ticks) : 0)
+             << " of " << bandwidth << " bytes/cycle)";
+    }
+    cout << endl;
+    cout.precision(-1);
+}
+
+// Print memory state within [m_base, m_base + m_size) relative to m_base (m_size = 0 for all).
+void data_memory_t::print_state(uint64_t m_base, uint64_t m_size) const {
     cout << endl << "Memory state (only accessed addresses):" << endl;
-    for(uint64_t i = 0; i < num_dwords; i++) {
-        if(accessed[i]) { cout << "(" << (i<<3) << ") = " << memory[i] << endl; }
+    // Sort the page numbers to print addresses in order.
+    vector<uint64_t> page_nums;
+    for(unordered_map<uint64_t, mem_page_t>::const_iterator it = pages.begin();
+        it != pages.end(); it++) {
+        // Page tables are not part of the program data.
+        if(page_table_base && ((it->first << mem_page_bits) >= page_table_base)) { continue; }
+        uint64_t addr = it->first << mem_page_bits;
+        if(m_size && ((addr < m_base) || (addr - m_base >= m_size))) { continue; }
+        page_nums.push_back(it->first);
     }
+    sort(page_nums.begin(), page_nums.end());
+    for(size_t p = 0; p < page_nums.size(); p++) {
+        const mem_page_t &page = pages.find(page_nums[p])->second;
+        for(uint64_t i = 0; i < mem_page_dwords; i++) {
+            if((page.touched[i>>6] >> (i&63)) & 0b1) {
+                cout << "(" << (((page_nums[p] << mem_page_bits) | (i<<3)) - m_base) << ") = "
+                     << page.data[i] << endl;
+            }
+        }
+    }
+}
+
+// Register memory controller stats.
+void data_memory_t::register_stats(stats_t *m_stats, const string &m_prefix) {
+    m_stats->add_counter(m_prefix + ".reads", &num_reads, "Number of read requests");
+    m_stats->add_counter(m_prefix + ".writes", &num_writes, "Number of write requests");
+    m_stats->add_counter(m_prefix + ".rejects", &num_rejects,
+                         "Number of requests rejected by a full queue");
+    m_stats->add_counter(m_prefix + ".queueing_delay", &queueing_delay,
+                         "Total cycles waiting for data transfer");
+    m_stats->add_counter(m_prefix + ".bus_busy", &bus_busy, "Cycles of data transfer");
+    m_stats->add_counter(m_prefix + ".bytes", &bytes_transferred, "Bytes of data transfer");
+    m_stats->add_formula(m_prefix + ".avg_queueing_delay", m_prefix + ".queueing_delay",
+                         m_prefix + ".reads + " + m_prefix + ".writes",
+                         "Average queueing delay in cycles");
 }
 
@@ -2,36 +2,127 @@
 #define __KITE_DATA_MEMORY_H__
 
 #include <cstdint>
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Memory is backed by pages that are allocated on first touch. Each page
+// holds 512 doublewords, and host memory for pages is carved out of 2MB
+// chunks that can be backed by huge pages.
+#define mem_page_bits       12
+#define mem_page_dwords     (1 << (mem_page_bits - 3))
+#define mem_chunk_size      (uint64_t(2) << 20)
+
+// A binary memory image starts with a header and a table of segments. Each
+// segment is a page-aligned address range of raw little-endian doublewords
+// stored at a page-aligned file offset, so that the image can be mapped
+// copy-on-write directly into the simulated memory.
+#define mem_image_magic     "KITEMEM"
+#define mem_image_version   1
 
 class data_cache_t;
+class dram_t;
+class stats_t;
+
+// Memory page
+struct mem_page_t {
+    int64_t *data;                                          // Doublewords of the page
+    uint64_t touched[mem_page_dwords >> 6];                 // Bitmap of accessed doublewords
+};
+
+// Memory image header
+struct mem_image_header_t {
+    char magic[8];                                          // Magic string
+    uint64_t version;                                       // Image format version
+    uint64_t num_segments;                                  // Number of segments
+};
+
+// Memory image segment
+struct mem_image_segment_t {
+    uint64_t addr;                                          // Base address of the segment
+    uint64_t size;                                          // Segment size in bytes
+    uint64_t offset;                                        // File offset of the segment data
+};
+
+// Memory request
+struct mem_request_t {
+    uint64_t id;                                            // Request ID
+    uint64_t addr;                                          // Block address
+    uint64_t size;                                          // Block size in bytes
+    bool write;                                             // Write request?
+    data_cache_t *requester;                                // Requester of a read
+    int64_t *data;                                          // Block data
+    uint64_t arrival;                                       // Arrival cycle
+    uint64_t ready;                                         // Cycle when the memory access completes
+    uint64_t done;                                          // Cycle when the data transfer completes
+};
 
 // Memory
 class data_memory_t {
 public:
-    data_memory_t(uint64_t *m_ticks, uint64_t m_memory_size,
-                  uint64_t m_code_segment_size, uint64_t m_latency = 0);
+    data_memory_t(uint64_t *m_ticks, uint64_t m_code_segment_size, uint64_t m_latency = 0,
+                  uint64_t m_page_table_base = 0, bool m_huge_pages = false,
+                  const char *m_mem_state = "mem_state", uint64_t m_queue_depth = 16,
+                  uint64_t m_bandwidth = 0, bool m_in_order = true);
     ~data_memory_t();
 
-    void connect(data_cache_t *m_cache);                    // Connect to the upper-level cache.
-    void load_block(uint64_t m_addr, uint64_t m_block_size);// Load a memory block.
+    void connect(dram_t *m_dram);                           // Connect to a DRAM backend.
+    // Request a memory block for a cache, and return false if the request queue is full.
+    bool load_block(uint64_t m_addr, uint64_t m_block_size, data_cache_t *m_requester);
+    // Write back a memory block, and return false if the request queue is full.
+    bool store_block(uint64_t m_addr, uint64_t m_block_size);
     void run();                                             // Run the data memory.
-    void print_state() const;                               // Print memory state.
+    int64_t read_dword(uint64_t m_addr);                    // Read a doubleword without timing.
+    void write_dword(uint64_t m_addr, int64_t m_data);      // Write a doubleword without timing.
+    uint64_t alloc_page_frame();                            // Allocate a page table frame.
+    void print_stats();                                     // Print memory controller stats.
+    void register_stats(stats_t *m_stats, const std::string &m_prefix);   // Register stats.
+    // Load a memory state file at a base address.
+    void load_mem_state(const char *m_file, uint64_t m_base = 0);
+    // Print memory state within [m_base, m_base + m_size) relative to m_base (m_size = 0 for all).
+    void print_state(uint64_t m_base = 0, uint64_t m_size = 0) const;
+    void save_mem_image(const char *m_file) const;          // Save memory state as a binary image.
 
 private:
-    void load_mem_state();                                  // Load initial memory state.
+    void load_mem_image(int m_fd, const char *m_file, uint64_t m_base); // Map a binary memory image.
+    mem_page_t* get_page(uint64_t m_addr);                  // Get a page, and allocate it on first touch.
+    void enqueue(uint64_t m_addr, uint64_t m_size, bool m_write,
+                 data_cache_t *m_requester, int64_t *m_data);   // Enqueue a memory request.
+    int64_t* alloc_page_data();                             // Allocate host memory for a page.
 
-    data_cache_t *cache;                                    // Pointer to the upper-level cache
+    dram_t *dram;                                           // Pointer to the DRAM backend
     uint64_t *ticks;                                        // Pointer to processor ticks
 
-    int64_t *memory;                                        // Memory space
-    bool *accessed;                                         // Access history map
-    uint64_t memory_size;                                   // Memory size
+    std::unordered_map<uint64_t, mem_page_t> pages;         // Page map indexed by page number
+    uint64_t last_page_num;                                 // Page number of the last lookup
+    mem_page_t *last_page;                                  // Page of the last lookup
+    std::vector<int64_t*> chunks;                           // Host memory chunks
+    std::vector<std::pair<void*, uint64_t> > images;        // Mapped memory images
+    uint64_t chunk_used;                                    // Bytes used in the last chunk
+    bool huge_pages;                                        // Back chunks with huge pages?
     uint64_t code_segment_size;                             // Code segment size
-    uint64_t num_dwords;                                    // Number of doublewords
+    uint64_t page_table_base;                               // Base address of page table region
+    uint64_t page_table_top;                                // Next free page table frame
+
+    // Requests wait in a bounded queue until the memory access completes,
+    // and their data are then transferred at a limited number of bytes per
+    // cycle. Responses are delivered in request order or in any order.
+    std::list<mem_request_t> requests;                      // Request queue
+    uint64_t queue_depth;                                   // Request queue depth
+    uint64_t bandwidth;                                     // Bytes per cycle (0 for unlimited)
+    bool in_order;                                          // Deliver responses in request order?
+    uint64_t latency;                                       // Memory latency without DRAM backend
+    uint64_t next_id;                                       // Next request ID
+    uint64_t bus_free;                                      // Cycle when the data bus is free
 
-    uint64_t latency;                                       // Memory latency
-    uint64_t resp_ticks;                                    // Response ticks
-    int64_t *req_block;                                     // Requested block data
+    uint64_t num_reads;                                     // Number of read requests
+    uint64_t num_writes;                                    // Number of write requests
+    uint64_t num_rejects;                                   // Number of requests rejected by a full queue
+    uint64_t queueing_delay;                                // Total cycles waiting for data transfer
+    uint64_t bus_busy;                                      // Cycles of data transfer
+    uint64_t bytes_transferred;                             // Bytes of data transfer
 };
 
 #endif
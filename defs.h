@@ -2,6 +2,8 @@
 #define __KITE_DEFS_H__
 
 #include <algorithm>
+#include <cctype>
+#include <cstdint>
 #include <string>
 #include <vector>
 
@@ -176,6 +178,9 @@ static unsigned kite_op_latency[num_kite_opcodes] __attribute__((unused)) = {
     1,  // op_jal
 };
 
+// Maximum ALU latency of configurable instruction latencies
+#define max_op_latency      1024
+
 // Kite instruction strings aligned with the instructions list
 static std::string kite_opcode_str[num_kite_opcodes] __attribute__((unused)) = {
     "nop",
@@ -252,15 +257,62 @@ static std::string kite_reg_str[num_kite_regs] __attribute__((unused)) = {
     "x31",
 };
 
+// Perfect hash table of opcode strings. An opcode string hashes to a unique
+// slot with a multiplicative hash of its lowercase characters.
+#define opcode_hash_bits    6
+#define opcode_hash_mult    0x66531dafu
+static kite_opcode kite_opcode_hash[1 << opcode_hash_bits] __attribute__((unused)) = {
+    num_kite_opcodes, op_xor,           num_kite_opcodes, op_nop,             //  0- 3
+    op_blt,           num_kite_opcodes, num_kite_opcodes, op_bge,             //  4- 7
+    op_beq,           op_srai,          num_kite_opcodes, op_ld,              //  8-11
+    num_kite_opcodes, op_srl,           num_kite_opcodes, num_kite_opcodes,   // 12-15
+    num_kite_opcodes, op_addi,          num_kite_opcodes, num_kite_opcodes,   // 16-19
+    num_kite_opcodes, op_and,           op_jalr,          op_lui,             // 20-23
+    op_sub,           num_kite_opcodes, op_rem,           op_add,             // 24-27
+    op_andi,          op_srli,          op_remu,          num_kite_opcodes,   // 28-31
+    op_jal,           num_kite_opcodes, op_ori,           num_kite_opcodes,   // 32-35
+    num_kite_opcodes, num_kite_opcodes, op_divu,          op_xori,            // 36-39
+    num_kite_opcodes, num_kite_opcodes, num_kite_opcodes, op_mul,             // 40-43
+    num_kite_opcodes, num_kite_opcodes, num_kite_opcodes, op_slli,            // 44-47
+    num_kite_opcodes, num_kite_opcodes, num_kite_opcodes, op_sra,             // 48-51
+    num_kite_opcodes, num_kite_opcodes, op_bne,           op_sll,             // 52-55
+    num_kite_opcodes, num_kite_opcodes, op_sd,            op_div,             // 56-59
+    num_kite_opcodes, op_or,            num_kite_opcodes, num_kite_opcodes,   // 60-63
+};
+
 // Numbers
 static std::string numbers = "0123456789";
 
-// Minimum memory size
-#define min_memory_size 8192
+// Look up the kite_opcode of a case-insensitive string of m_len characters.
+static inline kite_opcode lookup_opcode(const char *m_str, size_t m_len) {
+    uint32_t hash = 0;
+    for(size_t i = 0; i < m_len; i++) { hash = hash * 31 + uint32_t(tolower(m_str[i])); }
+    kite_opcode op = kite_opcode_hash[(hash * opcode_hash_mult) >> (32 - opcode_hash_bits)];
+    if(op == num_kite_opcodes) { return num_kite_opcodes; }
+    const std::string &op_str = kite_opcode_str[op];
+    if(op_str.size() != m_len) { return num_kite_opcodes; }
+    for(size_t i = 0; i < m_len; i++) {
+        if(tolower(m_str[i]) != op_str[i]) { return num_kite_opcodes; }
+    }
+    return op;
+}
+
+// Look up the kite_reg of a case-insensitive string of m_len characters.
+// Register strings are x0 to x31 without leading zeros.
+static inline kite_reg lookup_regnum(const char *m_str, size_t m_len) {
+    if((m_len < 2) || (m_len > 3) || (tolower(m_str[0]) != 'x')) { return num_kite_regs; }
+    unsigned reg = 0;
+    for(size_t i = 1; i < m_len; i++) {
+        if((m_str[i] < '0') || (m_str[i] > '9')) { return num_kite_regs; }
+        reg = reg * 10 + (m_str[i] - '0');
+    }
+    if(((m_len == 3) && (m_str[1] == '0')) || (reg >= num_kite_regs)) { return num_kite_regs; }
+    return kite_reg(reg);
+}
 
 // Convert a string to kite_opcode
 #define get_opcode(m_string) \
-    (kite_opcode)distance(&kite_opcode_str[0], find(&kite_opcode_str[0], &kite_opcode_str[num_kite_opcodes], m_string.c_str()))
+    lookup_opcode(m_string.data(), m_string.size())
 
 // Get the kite_opcode_type of m_op
 #define get_op_type(m_op) \
@@ -272,7 +324,7 @@ static std::string numbers = "0123456789";
 
 // Convert a string to kite_reg
 #define get_regnum(m_string) \
-    (kite_reg)distance(&kite_reg_str[0], find(&kite_reg_str[0], &kite_reg_str[num_kite_regs], m_string.c_str()))
+    lookup_regnum(m_string.data(), m_string.size())
 
 // Convert a string to 64-bit integer.
 #define get_imm(m_string) \
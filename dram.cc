@@ -0,0 +1,197 @@
+#include <iostream>
+#include "dram.h"
+#include "stats.h"
+
+using namespace std;
+
+dram_t::dram_t(uint64_t *m_ticks, uint64_t m_channels, uint64_t m_ranks,
+               uint64_t m_banks, uint64_t m_row_size, bool m_open_page,
+               uint64_t m_t_rcd, uint64_t m_t_cas, uint64_t m_t_rp,
+               uint64_t m_t_ras, uint64_t m_t_burst,
+               uint64_t m_t_refi, uint64_t m_t_rfc) :
+    ticks(m_ticks),
+    num_channels(m_channels),
+    num_ranks(m_ranks),
+    num_banks(m_banks),
+    row_size(m_row_size),
+    open_page(m_open_page),
+    t_rcd(m_t_rcd),
+    t_cas(m_t_cas),
+    t_rp(m_t_rp),
+    t_ras(m_t_ras),
+    t_burst(m_t_burst),
+    t_refi(m_t_refi),
+    t_rfc(m_t_rfc),
+    banks(0),
+    bus_free(0),
+    next_refresh(m_t_refi),
+    num_reads(0),
+    num_writes(0),
+    num_row_hits(0),
+    num_row_empty(0),
+    num_row_conflicts(0),
+    num_refreshes(0),
+    read_latency(0),
+    write_latency(0) {
+    if(!num_channels || !num_ranks || !num_banks || !row_size) {
+        cerr << "Error: invalid DRAM organization" << endl;
+        exit(1);
+    }
+    // Allocate banks and channel data buses.
+    banks    = new dram_bank_t[num_channels * num_ranks * num_banks]();
+    bus_free = new uint64_t[num_channels]();
+}
+
+dram_t::~dram_t() {
+    // Deallocate the banks and channel data buses.
+    delete [] banks;
+    delete [] bus_free;
+}
+
+// Enqueue a request.
+void dram_t::request(uint64_t m_id, uint64_t m_addr, bool m_write) {
+    dram_request_t req;
+    req.id      = m_id;
+    req.addr    = m_addr;
+    req.write   = m_write;
+    req.arrival = *ticks;
+    // Decode the address into channel, rank, bank, and row.
+    uint64_t index = m_addr / row_size;
+    req.channel = index % num_channels;   index /= num_channels;
+    uint64_t bank = index % num_banks;    index /= num_banks;
+    uint64_t rank = index % num_ranks;    index /= num_ranks;
+    req.bank    = (req.channel * num_ranks + rank) * num_banks + bank;
+    req.row     = index;
+    req.done    = 0;
+    queue.push_back(req);
+}
+
+// Run DRAM.
+void dram_t::run() {
+    refresh();
+    for(uint64_t c = 0; c < num_channels; c++) { schedule(c); }
+}
+
+// Retire a completed request, and return its ID.
+bool dram_t::retire(uint64_t &m_id) {
+    for(list<dram_request_t>::iterator it = inflight.begin(); it != inflight.end(); it++) {
+        if(it->done > *ticks) { continue; }
+        if(it->write) {
+            num_writes++;
+            write_latency += it->done - it->arrival;
+        }
+        else {
+            num_reads++;
+            read_latency += it->done - it->arrival;
+        }
+        m_id = it->id;
+        inflight.erase(it);
+        return true;
+    }
+    return false;
+}
+
+// Refresh all ranks when a refresh interval elapses. Refresh precharges
+// every bank, and banks are unavailable for the refresh duration.
+void dram_t::refresh() {
+    if(!t_refi || (*ticks < next_refresh)) { return; }
+    for(uint64_t b = 0; b < num_channels * num_ranks * num_banks; b++) {
+        banks[b].row_open = false;
+        banks[b].ready = (banks[b].ready > *ticks ? banks[b].ready : *ticks) + t_rp + t_rfc;
+    }
+    next_refresh += t_refi;
+    num_refreshes++;
+}
+
+// Issue a request on a channel with the first-ready, first-come first-serve
+// (FR-FCFS) policy. A row buffer hit to a ready bank is issued first, and
+// the oldest request to a ready bank is issued otherwise.
+void dram_t::schedule(uint64_t m_channel) {
+    list<dram_request_t>::iterator pick = queue.end();
+    for(list<dram_request_t>::iterator it = queue.begin(); it != queue.end(); it++) {
+        dram_bank_t &bank = banks[it->bank];
+        if((it->channel != m_channel) || (bank.ready > *ticks)) { continue; }
+        if(bank.row_open && (bank.open_row == it->row)) { pick = it; break; }
+        if(pick == queue.end()) { pick = it; }
+    }
+    if(pick == queue.end()) { return; }
+
+    // Calculate the cycle of the column command.
+    dram_bank_t &bank = banks[pick->bank];
+    uint64_t column = *ticks;
+    if(bank.row_open && (bank.open_row == pick->row)) { num_row_hits++; }
+    else {
+        uint64_t activate = *ticks;
+        if(bank.row_open) {
+            // Precharge the open row after it has been active for tRAS.
+            num_row_conflicts++;
+            activate = (bank.activated + t_ras > *ticks ? bank.activated + t_ras : *ticks) + t_rp;
+        }
+        else { num_row_empty++; }
+        bank.row_open = true;
+        bank.open_row = pick->row;
+        bank.activated = activate;
+        column = activate + t_rcd;
+    }
+    // Data transfer waits for the channel data bus.
+    pick->done = (column + t_cas > bus_free[m_channel] ? column + t_cas : bus_free[m_channel]) + t_burst;
+    bus_free[m_channel] = pick->done;
+
+    if(open_page) { bank.ready = column + t_burst; }
+    else {
+        // The closed-page policy precharges the row after the access.
+        bank.row_open = false;
+        bank.ready = (bank.activated + t_ras > pick->done ? bank.activated + t_ras : pick->done) + t_rp;
+    }
+    inflight.push_back(*pick);
+    queue.erase(pick);
+}
+
+// Print DRAM stats.
+void dram_t::print_stats() {
+    uint64_t num_accesses = num_row_hits + num_row_empty + num_row_conflicts;
+    cout << endl << "DRAM stats:" << endl;
+    cout << "    Organization = " << num_channels << " channel(s) x " << num_ranks
+         << " rank(s) x " << num_banks << " banks, " << row_size << "-byte rows, "
+         << (open_page ? "open" : "closed") << "-page policy" << endl;
+    cout << "    Number of reads = " << num_reads << endl;
+    cout << "    Number of writes = " << num_writes << endl;
+    cout << "    Number of refreshes = " << num_refreshes << endl;
+    cout.precision(3);
+    cout << "    Row hit rate = " << fixed
+         << (num_accesses ? double(num_row_hits) / double(num_accesses) : 0)
+         << " (" << num_row_hits << "/" << num_accesses << ")" << endl;
+    cout << "    Row conflict rate = " << fixed
+         << (num_accesses ? double(num_row_conflicts) / double(num_accesses) : 0)
+         << " (" << num_row_conflicts << "/" << num_accesses << ")" << endl;
+    cout << "    Average read latency = " << fixed
+         << (num_reads ? double(read_latency) / double(num_reads) : 0) << " cycles" << endl;
+    cout << "    Average write latency = " << fixed
+         << (num_writes ? double(write_latency) / double(num_writes) : 0) << " cycles" << endl;
+    cout.precision(-1);
+}
+
+// Register DRAM stats.
+void dram_t::register_stats(stats_t *m_stats, const string &m_prefix) {
+    string accesses = m_prefix + ".row_hits + " + m_prefix + ".row_empty + "
+                    + m_prefix + ".row_conflicts";
+    m_stats->add_counter(m_prefix + ".reads", &num_reads, "Number of reads");
+    m_stats->add_counter(m_prefix + ".writes", &num_writes, "Number of writes");
+    m_stats->add_counter(m_prefix + ".row_hits", &num_row_hits, "Number of row buffer hits");
+    m_stats->add_counter(m_prefix + ".row_empty", &num_row_empty,
+                         "Number of accesses to a closed bank");
+    m_stats->add_counter(m_prefix + ".row_conflicts", &num_row_conflicts,
+                         "Number of row buffer conflicts");
+    m_stats->add_counter(m_prefix + ".refreshes", &num_refreshes, "Number of refreshes");
+    m_stats->add_counter(m_prefix + ".read_latency", &read_latency, "Total read latency");
+    m_stats->add_counter(m_prefix + ".write_latency", &write_latency, "Total write latency");
+    m_stats->add_formula(m_prefix + ".row_hit_rate", m_prefix + ".row_hits", accesses,
+                         "Row hit rate");
+    m_stats->add_formula(m_prefix + ".row_conflict_rate", m_prefix + ".row_conflicts", accesses,
+                         "Row conflict rate");
+    m_stats->add_formula(m_prefix + ".avg_read_latency", m_prefix + ".read_latency",
+                         m_prefix + ".reads", "Average read latency in cycles");
+    m_stats->add_formula(m_prefix + ".avg_write_latency", m_prefix + ".write_latency",
+                         m_prefix + ".writes", "Average write latency in cycles");
+}
+
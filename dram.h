@@ -0,0 +1,84 @@
+#ifndef __KITE_DRAM_H__
+#define __KITE_DRAM_H__
+
+#include <cstdint>
+#include <list>
+#include <string>
+
+class stats_t;
+
+// DRAM request
+struct dram_request_t {
+    uint64_t id;                                // Request ID
+    uint64_t addr;                              // Block address
+    bool write;                                 // Write request?
+    uint64_t arrival;                           // Arrival cycle
+    uint64_t channel;                           // Channel index
+    uint64_t bank;                              // Global bank index
+    uint64_t row;                               // Row index
+    uint64_t done;                              // Completion cycle
+};
+
+// DRAM bank
+struct dram_bank_t {
+    bool row_open;                              // Is a row open?
+    uint64_t open_row;                          // Open row index
+    uint64_t ready;                             // Cycle when the bank accepts a command
+    uint64_t activated;                         // Cycle of the last activation
+};
+
+// DRAM with per-bank row buffers and an FR-FCFS scheduler. Addresses are
+// interleaved as row | rank | bank | channel | column, so that consecutive
+// blocks within a row stay in the same bank. Timing parameters are in
+// processor cycles.
+class dram_t {
+public:
+    dram_t(uint64_t *m_ticks, uint64_t m_channels = 1, uint64_t m_ranks = 1,
+           uint64_t m_banks = 8, uint64_t m_row_size = 8192, bool m_open_page = true,
+           uint64_t m_t_rcd = 14, uint64_t m_t_cas = 14, uint64_t m_t_rp = 14,
+           uint64_t m_t_ras = 34, uint64_t m_t_burst = 4,
+           uint64_t m_t_refi = 7800, uint64_t m_t_rfc = 350);
+    ~dram_t();
+
+    void request(uint64_t m_id, uint64_t m_addr, bool m_write);    // Enqueue a request.
+    void run();                                     // Run DRAM.
+    bool retire(uint64_t &m_id);                    // Retire a completed request, and return its ID.
+    void print_stats();                             // Print DRAM stats.
+    void register_stats(stats_t *m_stats, const std::string &m_prefix);   // Register stats.
+
+private:
+    void refresh();                                 // Refresh ranks that are due.
+    void schedule(uint64_t m_channel);              // Issue a request on a channel.
+
+    uint64_t *ticks;                                // Pointer to processor clock ticks
+    uint64_t num_channels;                          // Number of channels
+    uint64_t num_ranks;                             // Number of ranks per channel
+    uint64_t num_banks;                             // Number of banks per rank
+    uint64_t row_size;                              // Row size in bytes
+    bool open_page;                                 // Open-page policy? (closed-page if false)
+    uint64_t t_rcd;                                 // Activate to column command delay
+    uint64_t t_cas;                                 // Column command to data delay
+    uint64_t t_rp;                                  // Precharge delay
+    uint64_t t_ras;                                 // Activate to precharge delay
+    uint64_t t_burst;                               // Data burst duration
+    uint64_t t_refi;                                // Refresh interval
+    uint64_t t_rfc;                                 // Refresh duration
+
+    dram_bank_t *banks;                             // Banks of all channels and ranks
+    uint64_t *bus_free;                             // Cycle when each channel data bus is free
+    uint64_t next_refresh;                          // Cycle of the next refresh
+    std::list<dram_request_t> queue;                // Request queue
+    std::list<dram_request_t> inflight;             // Issued requests
+
+    uint64_t num_reads;                             // Number of reads
+    uint64_t num_writes;                            // Number of writes
+    uint64_t num_row_hits;                          // Number of row buffer hits
+    uint64_t num_row_empty;                         // Number of accesses to a closed bank
+    uint64_t num_row_conflicts;                     // Number of row buffer conflicts
+    uint64_t num_refreshes;                         // Number of refreshes
+    uint64_t read_latency;                          // Total read latency
+    uint64_t write_latency;                         // Total write latency
+};
+
+#endif
+
@@ -0,0 +1,188 @@
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include "exec_trace.h"
+
+using namespace std;
+
+exec_trace_writer_t::exec_trace_writer_t(inst_memory_t *m_inst_memory, const char *m_file) :
+    inst_memory(m_inst_memory),
+    last_addr(m_inst_memory->num_insts(), 0),
+    num_records(0),
+    stream_size(0) {
+    file.open(m_file, ios::binary);
+    if(!file.is_open()) {
+        cerr << "Error: failed to open " << m_file << endl;
+        exit(1);
+    }
+    // Reserve space for the header, which is written when the trace is closed.
+    exec_trace_header_t header;
+    memset(&header, 0, sizeof(header));
+    file.write((const char*)&header, sizeof(header));
+    buffer.reserve(exec_trace_buffer_size + 16);
+}
+
+exec_trace_writer_t::~exec_trace_writer_t() {
+    write_buffer();
+
+    // Write the static instruction table.
+    exec_trace_header_t header;
+    memset(&header, 0, sizeof(header));
+    strncpy(header.magic, exec_trace_magic, sizeof(header.magic));
+    header.version     = exec_trace_version;
+    header.num_records = num_records;
+    header.stream_size = stream_size;
+    header.num_insts   = inst_memory->num_insts();
+    for(uint64_t i = 0; i < header.num_insts; i++) {
+        exec_trace_inst_t entry;
+        memset(&entry, 0, sizeof(entry));
+        const inst_t *inst = inst_memory->peek(i << 2);
+        if(inst) {
+            entry.imm     = inst->imm;
+            entry.op      = inst->op;
+            entry.rd_num  = inst->rd_num;
+            entry.rs1_num = inst->rs1_num;
+            entry.rs2_num = inst->rs2_num;
+        }
+        file.write((const char*)&entry, sizeof(entry));
+    }
+    // Write the header.
+    file.seekp(0);
+    file.write((const char*)&header, sizeof(header));
+    file.close();
+}
+
+// Record a committed instruction.
+void exec_trace_writer_t::record(const inst_t *m_inst) {
+    if(get_op_type(m_inst->op) == op_sb_type) { buffer.push_back(m_inst->branch_taken); }
+    else if(m_inst->op == op_jalr) {
+        uint64_t target = m_inst->resolved ? m_inst->next_pc :
+                          (m_inst->rs1_val + m_inst->imm) & -2;
+        write_varint(target - (m_inst->pc + 4));
+    }
+    else if((m_inst->op == op_ld) || (m_inst->op == op_sd)) {
+        uint64_t &addr = last_addr[m_inst->pc >> 2];
+        write_varint(m_inst->memory_addr - addr);
+        addr = m_inst->memory_addr;
+    }
+    num_records++;
+    if(buffer.size() >= exec_trace_buffer_size) { write_buffer(); }
+}
+
+// Write a signed variable-length integer. The value is zigzag-encoded so that
+// small negative distances are short, and each byte holds seven bits.
+void exec_trace_writer_t::write_varint(int64_t m_value) {
+    uint64_t value = (uint64_t(m_value) << 1) ^ uint64_t(m_value >> 63);
+    while(value >= 0x80) { buffer.push_back(value | 0x80); value >>= 7; }
+    buffer.push_back(value);
+}
+
+// Write the buffered stream to the file.
+void exec_trace_writer_t::write_buffer() {
+    file.write((const char*)buffer.data(), buffer.size());
+    stream_size += buffer.size();
+    buffer.clear();
+}
+
+exec_trace_reader_t::exec_trace_reader_t(inst_memory_t *m_inst_memory, const char *m_file) :
+    file_name(m_file),
+    buffer_pos(0),
+    stream_left(0),
+    num_left(0),
+    pc(4) {    // The first instruction is at PC = 4.
+    file.open(m_file, ios::binary);
+    if(!file.is_open()) {
+        cerr << "Error: failed to open " << m_file << endl;
+        exit(1);
+    }
+    exec_trace_header_t header;
+    if(!file.read((char*)&header, sizeof(header)) ||
+       strncmp(header.magic, exec_trace_magic, sizeof(header.magic)) ||
+       (header.version != exec_trace_version)) {
+        cerr << "Error: invalid execution trace " << m_file << endl;
+        exit(1);
+    }
+    // Read the static instruction table, and check it against the program.
+    insts.resize(header.num_insts);
+    file.seekg(sizeof(header) + header.stream_size);
+    if(header.num_insts &&
+       !file.read((char*)&insts[0], header.num_insts * sizeof(exec_trace_inst_t))) {
+        cerr << "Error: truncated execution trace " << m_file << endl;
+        exit(1);
+    }
+    bool match = (header.num_insts == m_inst_memory->num_insts());
+    for(uint64_t i = 1; match && (i < header.num_insts); i++) {
+        const inst_t *inst = m_inst_memory->peek(i << 2);
+        match = (insts[i].op == inst->op) && (insts[i].imm == inst->imm) &&
+                (insts[i].rd_num == inst->rd_num) && (insts[i].rs1_num == inst->rs1_num) &&
+                (insts[i].rs2_num == inst->rs2_num);
+    }
+    if(!match) {
+        cerr << "Error: execution trace " << m_file << " does not match the program" << endl;
+        exit(1);
+    }
+    file.seekg(sizeof(header));
+    stream_left = header.stream_size;
+    num_left    = header.num_records;
+    last_addr.resize(header.num_insts, 0);
+}
+
+exec_trace_reader_t::~exec_trace_reader_t() {
+}
+
+// Apply the next record to a correct-path instruction.
+void exec_trace_reader_t::resolve(inst_t *m_inst) {
+    if(!num_left) {
+        cerr << "Error: execution trace ended before PC = " << m_inst->pc << endl;
+        exit(1);
+    }
+    if(m_inst->pc != pc) {
+        cerr << "Error: execution trace diverged at PC = " << m_inst->pc
+             << " (expected PC = " << pc << ")" << endl;
+        exit(1);
+    }
+    const exec_trace_inst_t &code = insts[pc >> 2];
+    uint64_t next_pc = pc + 4;
+    if(get_op_type(code.op) == op_sb_type) {
+        m_inst->branch_taken = read_byte();
+        if(m_inst->branch_taken) { next_pc = pc + (code.imm << 1); }
+        m_inst->branch_target = next_pc;
+    }
+    else if(code.op == op_jal) { next_pc = pc + (code.imm << 1); }
+    else if(code.op == op_jalr) { next_pc += read_varint(); }
+    else if((code.op == op_ld) || (code.op == op_sd)) {
+        m_inst->memory_addr = (last_addr[pc >> 2] += read_varint());
+    }
+    m_inst->next_pc  = next_pc;
+    m_inst->resolved = true;
+    pc = next_pc;
+    num_left--;
+}
+
+// Read a signed variable-length integer.
+int64_t exec_trace_reader_t::read_varint() {
+    uint64_t value = 0, byte = 0;
+    unsigned shift = 0;
+    do {
+        byte = read_byte();
+        value |= (byte & 0x7f) << shift;
+        shift += 7;
+    } while(byte & 0x80);
+    return int64_t(value >> 1) ^ -int64_t(value & 1);
+}
+
+// Read a byte of the stream, and refill the buffer when it is empty.
+uint8_t exec_trace_reader_t::read_byte() {
+    if(buffer_pos == buffer.size()) {
+        uint64_t size = stream_left < exec_trace_buffer_size ? stream_left : exec_trace_buffer_size;
+        buffer.resize(size);
+        if(!size || !file.read((char*)&buffer[0], size)) {
+            cerr << "Error: truncated execution trace " << file_name << endl;
+            exit(1);
+        }
+        stream_left -= size;
+        buffer_pos = 0;
+    }
+    return buffer[buffer_pos++];
+}
+
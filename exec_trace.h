@@ -0,0 +1,87 @@
+#ifndef __KITE_EXEC_TRACE_H__
+#define __KITE_EXEC_TRACE_H__
+
+#include <cstdint>
+#include <fstream>
+#include <vector>
+#include "func_sim.h"
+#include "inst_memory.h"
+
+// An execution trace holds the committed instruction stream of a program. It
+// starts with a header, followed by a byte stream of dynamic outcomes and a
+// table of the static instructions indexed by PC/4. The PC of each record is
+// the next PC of the previous one, so the stream only encodes what the static
+// instruction cannot tell:
+//   - Conditional branch: one byte of the branch direction.
+//   - jalr: the signed jump distance from PC + 4 as a variable-length integer.
+//   - ld/sd: the signed distance of the memory address from the previous
+//     address of the same PC as a variable-length integer.
+// Other instructions take no bytes in the stream.
+#define exec_trace_magic        "KITEEXE"
+#define exec_trace_version      1
+#define exec_trace_buffer_size  (1 << 16)
+
+// Execution trace header
+struct exec_trace_header_t {
+    char magic[8];                          // Magic string
+    uint64_t version;                       // Trace format version
+    uint64_t num_records;                   // Number of committed instructions
+    uint64_t stream_size;                   // Size of the byte stream
+    uint64_t num_insts;                     // Number of entries in the static instruction table
+};
+
+// Static instruction of an execution trace
+struct exec_trace_inst_t {
+    int64_t imm;                            // Immediate
+    int32_t op;                             // Instruction operation
+    int32_t rd_num, rs1_num, rs2_num;       // Register operand indices
+    int32_t reserved;                       // Padding
+};
+
+// Execution trace writer
+class exec_trace_writer_t {
+public:
+    exec_trace_writer_t(inst_memory_t *m_inst_memory, const char *m_file);
+    ~exec_trace_writer_t();
+
+    void record(const inst_t *m_inst);      // Record a committed instruction.
+
+private:
+    void write_varint(int64_t m_value);     // Write a signed variable-length integer.
+    void write_buffer();                    // Write the buffered stream to the file.
+
+    inst_memory_t *inst_memory;             // Instruction memory for the static table
+    std::ofstream file;                     // Trace file
+    std::vector<uint64_t> last_addr;        // Last memory address per PC
+    std::vector<uint8_t> buffer;            // Stream buffer
+    uint64_t num_records;                   // Number of records
+    uint64_t stream_size;                   // Size of the written stream
+};
+
+// Execution trace reader. It replays the committed instruction stream as the
+// source of resolved instructions. Replayed instructions carry PCs, memory
+// addresses, and branch outcomes, but no register or memory values.
+class exec_trace_reader_t : public exec_source_t {
+public:
+    exec_trace_reader_t(inst_memory_t *m_inst_memory, const char *m_file);
+    ~exec_trace_reader_t();
+
+    void resolve(inst_t *m_inst);           // Apply the next record to a correct-path instruction.
+
+private:
+    int64_t read_varint();                  // Read a signed variable-length integer.
+    uint8_t read_byte();                    // Read a byte of the stream.
+
+    const char *file_name;                  // Trace file name
+    std::ifstream file;                     // Trace file
+    std::vector<exec_trace_inst_t> insts;   // Static instruction table
+    std::vector<uint64_t> last_addr;        // Last memory address per PC
+    std::vector<uint8_t> buffer;            // Stream buffer
+    uint64_t buffer_pos;                    // Read position in the buffer
+    uint64_t stream_left;                   // Bytes of the stream not yet buffered
+    uint64_t num_left;                      // Number of records not yet replayed
+    uint64_t pc;                            // PC of the next record
+};
+
+#endif
+
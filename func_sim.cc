@@ -0,0 +1,104 @@
+#include <cstdlib>
+#include <iostream>
+#include "alu.h"
+#include "func_sim.h"
+
+using namespace std;
+
+func_sim_t::func_sim_t(inst_memory_t *m_inst_memory, const char *m_reg_state,
+                       const char *m_mem_state, bool m_huge_pages, uint64_t m_ring_size) :
+    inst_memory(m_inst_memory),
+    reg_file(new reg_file_t(m_reg_state)),
+    data_memory(new data_memory_t(&ticks, m_inst_memory->num_insts()<<2, 0, 0,
+                                  m_huge_pages, m_mem_state)),
+    ticks(0),
+    ring(m_ring_size),
+    done(false),
+    stop(false) {
+}
+
+func_sim_t::~func_sim_t() {
+    // Release the thread if it is waiting for the ring to drain.
+    stop = true;
+    if(thread.joinable()) { thread.join(); }
+    delete reg_file;
+    delete data_memory;
+}
+
+// Start the functional model thread.
+void func_sim_t::start() {
+    thread = std::thread(&func_sim_t::run, this);
+}
+
+// Execute the program from PC = 4 until the PC leaves the program. Loads and
+// stores access the memory of the functional model directly without timing.
+void func_sim_t::run() {
+    inst_t inst;
+    exec_record_t record;
+    uint64_t pc = 4;
+    const inst_t *code = 0;
+    while(!stop && (code = inst_memory->peek(pc))) {
+        inst.pc      = pc;
+        inst.op      = code->op;
+        inst.imm     = code->imm;
+        inst.rs1_val = code->rs1_num > 0 ? reg_file->read(code->rs1_num) : 0;
+        inst.rs2_val = code->rs2_num > 0 ? reg_file->read(code->rs2_num) : 0;
+        inst.rd_val  = 0;
+        inst.memory_addr   = 0;
+        inst.branch_target = 0;
+        inst.branch_taken  = false;
+        alu_t::compute(&inst);
+        if(inst.op == op_ld) { inst.rd_val = data_memory->read_dword(inst.memory_addr); }
+        else if(inst.op == op_sd) { data_memory->write_dword(inst.memory_addr, inst.rs2_val); }
+        if(code->rd_num > 0) { reg_file->write(0, code->rd_num, inst.rd_val); }
+
+        record.pc            = pc;
+        record.rd_val        = inst.rd_val;
+        record.rs1_val       = inst.rs1_val;
+        record.rs2_val       = inst.rs2_val;
+        record.memory_addr   = inst.memory_addr;
+        record.branch_target = inst.branch_target;
+        record.branch_taken  = inst.branch_taken;
+        // Set the next PC.
+        if(inst.branch_target) { record.next_pc = inst.branch_target; }
+        else if(inst.op == op_jal) { record.next_pc = pc + (inst.imm<<1); }
+        else if(inst.op == op_jalr) { record.next_pc = (inst.rs1_val + inst.imm) & -2; }
+        else { record.next_pc = pc + 4; }
+        while(!ring.push(record)) {
+            if(stop) { return; }
+            this_thread::yield();
+        }
+        pc = record.next_pc;
+    }
+    done = true;
+}
+
+// Apply the next record to a correct-path instruction. The timing model
+// waits if the functional model has not produced the record yet.
+void func_sim_t::resolve(inst_t *m_inst) {
+    exec_record_t record;
+    while(true) {
+        // All records are in the ring once the program has ended.
+        bool ended = done;
+        if(ring.pop(record)) { break; }
+        else if(ended) {
+            cerr << "Error: functional model ended before PC = " << m_inst->pc << endl;
+            exit(1);
+        }
+        this_thread::yield();
+    }
+    if(record.pc != m_inst->pc) {
+        cerr << "Error: functional model diverged at PC = " << m_inst->pc
+             << " (expected PC = " << record.pc << ")" << endl;
+        exit(1);
+    }
+    m_inst->rd_val        = record.rd_val;
+    m_inst->rs1_val       = record.rs1_val;
+    m_inst->rs2_val       = record.rs2_val;
+    m_inst->memory_addr   = record.memory_addr;
+    m_inst->branch_target = record.branch_target;
+    m_inst->branch_taken  = record.branch_taken;
+    m_inst->next_pc       = record.next_pc;
+    m_inst->resolved      = true;
+}
+
@@ -0,0 +1,57 @@
+#ifndef __KITE_FUNC_SIM_H__
+#define __KITE_FUNC_SIM_H__
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include "data_memory.h"
+#include "inst_memory.h"
+#include "reg_file.h"
+#include "spsc_ring.h"
+
+// Resolved instruction record
+struct exec_record_t {
+    uint64_t pc;                            // Program counter
+    int64_t rd_val, rs1_val, rs2_val;       // Register operand values
+    uint64_t memory_addr;                   // Data memory address
+    uint64_t branch_target;                 // Actual branch target
+    uint64_t next_pc;                       // PC of the next instruction
+    bool branch_taken;                      // Is a branch actually taken?
+};
+
+// Source of resolved instructions for the timing model
+class exec_source_t {
+public:
+    virtual ~exec_source_t() {}
+
+    // Apply the next record to a correct-path instruction.
+    virtual void resolve(inst_t *m_inst) = 0;
+};
+
+// Functional model. It executes the program on its own thread with its own
+// registers and memory, and passes a resolved record of every committed
+// instruction to the timing model through a ring buffer.
+class func_sim_t : public exec_source_t {
+public:
+    func_sim_t(inst_memory_t *m_inst_memory, const char *m_reg_state, const char *m_mem_state,
+               bool m_huge_pages = false, uint64_t m_ring_size = 4096);
+    ~func_sim_t();
+
+    void start();                           // Start the functional model thread.
+    void resolve(inst_t *m_inst);           // Apply the next record to a correct-path instruction.
+
+private:
+    void run();                             // Execute the program.
+
+    inst_memory_t *inst_memory;             // Instruction memory (shared, read-only)
+    reg_file_t *reg_file;                   // Register file of the functional model
+    data_memory_t *data_memory;             // Data memory of the functional model
+    uint64_t ticks;                         // Clock ticks of the data memory (unused)
+    spsc_ring_t<exec_record_t> ring;        // Records from the functional model to the timing model
+    std::thread thread;                     // Functional model thread
+    std::atomic<bool> done;                 // Has the program ended?
+    std::atomic<bool> stop;                 // Is the timing model finished?
+};
+
+#endif
+
@@ -8,6 +8,8 @@ using namespace std;
 
 inst_t::inst_t() :
     pc(0),
+    seq(0),
+    tid(0),
     op(op_nop),
     rd_num(-1),
     rs1_num(-1),
@@ -22,11 +24,20 @@ inst_t::inst_t() :
     branch_target(0),
     pred_target(0),
     branch_taken(false),
-    pred_taken(false) {
+    pred_taken(false),
+    pred_val(0),
+    val_predicted(false),
+    val_speculated(false),
+    order_violation(false),
+    resolved(false),
+    next_pc(0),
+    fused(0) {
 }
 
 inst_t::inst_t(const inst_t &m_inst) :
     pc(m_inst.pc),
+    seq(m_inst.seq),
+    tid(m_inst.tid),
     op(m_inst.op),
     rd_num (m_inst.rd_num),
     rs1_num(m_inst.rs1_num),
@@ -42,10 +53,18 @@ inst_t::inst_t(const inst_t &m_inst) :
     branch_target(m_inst.branch_target),
     pred_target(m_inst.pred_target),
     branch_taken(m_inst.branch_taken),
-    pred_taken(m_inst.pred_taken) {
+    pred_taken(m_inst.pred_taken),
+    pred_val(m_inst.pred_val),
+    val_predicted(m_inst.val_predicted),
+    val_speculated(m_inst.val_speculated),
+    order_violation(m_inst.order_violation),
+    resolved(m_inst.resolved),
+    next_pc(m_inst.next_pc),
+    fused(0) {  // Instructions are fused after they are copied out of the memory.
 }
 
 inst_t::~inst_t() {
+    delete fused;
 }
 
 // Convert a Kite instruction to string format.
@@ -142,21 +161,21 @@ string get_inst_str(inst_t *inst, bool details) {
                    << inst->imm                 << "("
                    << inst->label               << ")"
                    << "]";
-#ifdef BR_PRED
-                ss << " (pred "
-                   << (inst->pred_taken ? "T" : "NT");
-                if(inst->branch_target) {
-                    ss << " / "
-                       << (inst->branch_taken ? "T" : "NT");
+                // A branch with a predicted target shows its prediction.
+                if(inst->pred_target) {
+                    ss << " (pred "
+                       << (inst->pred_taken ? "T" : "NT");
+                    if(inst->branch_target) {
+                        ss << " / "
+                           << (inst->branch_taken ? "T" : "NT");
+                    }
+                    ss << ")";
                 }
-                ss << ")";
-#else
-                if(inst->branch_target) {
+                else if(inst->branch_target) {
                     ss << " ("
                        << (inst->branch_taken ? "T" : "NT")
                        << ")";
                 }
-#endif
             }
             break;
         }
@@ -12,6 +12,8 @@ public:
     ~inst_t();
 
     uint64_t pc;                        // Program counter
+    uint64_t seq;                       // Sequence number in fetch order
+    unsigned tid;                       // Hardware thread ID
     kite_opcode op;                     // Instruction operation
     int rd_num, rs1_num, rs2_num;       // Register operand indices
     int64_t rd_val, rs1_val, rs2_val;   // Register operand values
@@ -24,6 +26,13 @@ public:
     uint64_t pred_target;               // Predicted branch target
     bool branch_taken;                  // Is a branch actually taken?
     bool pred_taken;                    // Is a branch predicted to be taken?
+    int64_t pred_val;                   // Predicted value of a load
+    bool val_predicted;                 // Is the value of a load predicted?
+    bool val_speculated;                // Is the predicted value given to dependents?
+    bool order_violation;               // Did a load run ahead of a store to the same address?
+    bool resolved;                      // Are the results given by the functional model or a trace?
+    uint64_t next_pc;                   // PC of the next instruction (resolved only)
+    inst_t *fused;                      // Second instruction of a fused pair (owned)
 };
 
 // Convert Kite instruction to string format.
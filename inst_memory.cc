@@ -1,13 +1,84 @@
 #include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
 #include <fstream>
 #include <iostream>
+#include <sstream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #include "inst_memory.h"
 
 using namespace std;
 
-inst_memory_t::inst_memory_t(const char *m_program_code) {
-    memory.reserve(100);                // Reserve space for instructions.
-    load_program_code(m_program_code);  // Load a program code.
+// Token of an instruction line that points into the program code
+struct asm_token_t {
+    const char *str;                        // First character of the token
+    size_t len;                             // Token length
+};
+
+// Maximum number of tokens kept per line (a label, an opcode, and three operands)
+#define max_asm_tokens      5
+
+// Check if a character ends a token.
+#define is_token_delim(m_char) \
+    ((m_char == ' ') || (m_char == '\t') || (m_char == ',') || \
+     (m_char == '(') || (m_char == ')') || (m_char == ':'))
+
+// Check if a character separates tokens.
+#define is_token_space(m_char) \
+    ((m_char == ' ') || (m_char == '\t') || (m_char == ',') || \
+     (m_char == '(') || (m_char == ')'))
+
+// Convert a token to a lowercase string.
+static string lower_str(const char *m_str, size_t m_len) {
+    string str(m_str, m_len);
+    transform(str.begin(), str.end(), str.begin(), ::tolower);
+    return str;
+}
+
+// Check if a token has a valid register format.
+static bool is_reg_token(const asm_token_t &m_token) {
+    return lookup_regnum(m_token.str, m_token.len) != num_kite_regs;
+}
+
+// Check if a token is an integer number.
+static bool is_num_token(const asm_token_t &m_token) {
+    size_t i = (m_token.len && (m_token.str[0] == '-')) ? 1 : 0;
+    if(i == m_token.len) { return false; }
+    for(; i < m_token.len; i++) {
+        if((m_token.str[i] < '0') || (m_token.str[i] > '9')) { return false; }
+    }
+    return true;
+}
+
+// Check if a register index of a cached instruction is valid (-1 if unused).
+static bool is_cached_reg(int32_t m_num) {
+    return (m_num >= -1) && (m_num < num_kite_regs);
+}
+
+// Convert a number token to a 64-bit integer. Out-of-range values saturate
+// as strtoll does.
+static int64_t get_token_imm(const asm_token_t &m_token) {
+    bool neg = m_token.str[0] == '-';
+    uint64_t limit = neg ? uint64_t(INT64_MAX) + 1 : uint64_t(INT64_MAX);
+    uint64_t val = 0;
+    for(size_t i = neg ? 1 : 0; i < m_token.len; i++) {
+        uint64_t digit = m_token.str[i] - '0';
+        if(val > (limit - digit) / 10) { return neg ? INT64_MIN : INT64_MAX; }
+        val = val * 10 + digit;
+    }
+    return neg ? int64_t(0 - val) : int64_t(val);
+}
+
+inst_memory_t::inst_memory_t(const char *m_program_code, bool m_asm_cache,
+                             const uint64_t *m_op_latency) :
+    far_label_index(-1) {
+    // ALU latencies are taken from the defaults unless given.
+    for(unsigned i = 0; i < num_kite_opcodes; i++) {
+        op_latency[i] = m_op_latency ? m_op_latency[i] : get_op_latency(i);
+    }
+    load_program_code(m_program_code, m_asm_cache); // Load a program code.
 }
 
 inst_memory_t::~inst_memory_t() {
@@ -23,162 +94,317 @@ inst_t* inst_memory_t::read(uint64_t m_pc) {
     return inst;
 }
 
+// Get an instruction in memory without copying it.
+const inst_t* inst_memory_t::peek(uint64_t m_pc) const {
+    m_pc = m_pc >> 2;
+    return (m_pc && (m_pc < memory.size())) ? &memory[m_pc] : 0;
+}
+
 // Get the total number of instructions in memory.
 size_t inst_memory_t::num_insts() const{
     return memory.size();
 }
 
-// Load a program code.
-void inst_memory_t::load_program_code(const char *m_program_code) {
+// Load a program code. The file is mapped and scanned in a single pass
+// without copying lines. A branch or jump to a label that is not yet
+// defined is recorded in the fixup list of the label, and the label
+// definition resolves it.
+void inst_memory_t::load_program_code(const char *m_program_code, bool m_asm_cache) {
     // Open a program code file.
-    fstream file_stream;
-    file_stream.open(m_program_code, fstream::in);
-    if(!file_stream.is_open()) {
+    int fd = open(m_program_code, O_RDONLY);
+    struct stat file_stat;
+    if((fd < 0) || fstat(fd, &file_stat)) {
         cerr << "Error: failed to open " << m_program_code << endl;
         exit(1);
     }
+    size_t code_size = file_stat.st_size;
+    const char *code = 0;
+    if(code_size) {
+        code = (const char*)mmap(0, code_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if(code == MAP_FAILED) {
+            cerr << "Error: failed to open " << m_program_code << endl;
+            exit(1);
+        }
+        madvise((void*)code, code_size, MADV_SEQUENTIAL);
+    }
+    close(fd);
+
+    // Load the assembled program from the cache if the program code is unchanged.
+    string cache_file = string(m_program_code) + asm_cache_suffix;
+    uint64_t code_hash = 0xcbf29ce484222325;
+    if(m_asm_cache) {
+        // 64-bit FNV-1a hash of the program code
+        for(size_t i = 0; i < code_size; i++) {
+            code_hash = (code_hash ^ uint8_t(code[i])) * 0x100000001b3;
+        }
+        if(load_asm_cache(cache_file, code_size, code_hash)) {
+            if(code_size) { munmap((void*)code, code_size); }
+            return;
+        }
+    }
 
     // Insert a nop instruction at PC = 0 to make it as invalid.
-    memory.insert(memory.begin(), inst_t());
+    memory.push_back(inst_t());
 
     // Read and parse a program code.
-    string line;
     size_t line_num = 0;
-    while(getline(file_stream, line)) {
+    for(const char *line = code, *code_end = code + code_size; line < code_end;) {
+        const char *line_end = (const char*)memchr(line, '\n', code_end - line);
+        if(!line_end) { line_end = code_end; }
+        const char *next_line = line_end + (line_end < code_end ? 1 : 0);
         line_num++;
-        // Erase leading spaces.
-        line.erase(0, line.find_first_not_of(" \t"));
+        // Skip leading spaces.
+        while((line < line_end) && ((*line == ' ') || (*line == '\t'))) { line++; }
         // Crop everything after a comment symbol.
-        if(line.find_first_of("#") != string::npos) { line.erase(line.find_first_of("#")); }
-        // Skip blank lines.
-        if(!line.size()) { continue; }
-
-        // Parse an instruction string.
-        transform(line.begin(), line.end(), line.begin(), ::tolower);
-        parse_inst_str(line, line_num);
+        if(line < line_end) {
+            const char *comment = (const char*)memchr(line, '#', line_end - line);
+            if(comment) { line_end = comment; }
+        }
+        // Parse an instruction line unless it is blank.
+        if(line < line_end) { parse_inst(line, line_end, line_num); }
+        line = next_line;
     }
 
-    // Close the program code file.
-    file_stream.close();
+    // Unmap the program code file.
+    if(code_size) { munmap((void*)code, code_size); }
 
-    // Revisit instructions, and replace labels with immediate values.
-    for(size_t i = 0; i < memory.size(); i++) {
-        inst_t &inst = memory[i];
-        if((get_op_type(inst.op) == op_sb_type) || (get_op_type(inst.op) == op_uj_type)) {
-            map<string, int64_t>::iterator it = labels.find(inst.label);
-            if(it == labels.end()) {
-                cerr << "Error: unknown label : " << get_inst_str(&inst) << endl;
-                exit(1);
-            }
-            // PC-relative distance
-            inst.imm = ((it->second) - int64_t(inst.pc)) >> 1;
-            // Check if the PC-relative distance fits into the immediate field of instruction.
-            unsigned imm_width = (get_op_type(inst.op) == op_sb_type ? 12 : 20) - 1;
-            if(inst.imm >= 0 ? inst.imm >> imm_width : (inst.imm >> imm_width) != -1) {
-                cerr << "Error: branch target is too far away for "
-                     << get_inst_str(&inst) << endl;
-                exit(1);
-            }
+    // Report the first instruction with an unknown label or a label that is too far away.
+    size_t unknown_label_index = -1;
+    for(unordered_map<string, label_t>::iterator it = labels.begin(); it != labels.end(); it++) {
+        if((it->second.pc < 0) && (it->second.fixups[0] < unknown_label_index)) {
+            unknown_label_index = it->second.fixups[0];
         }
     }
+    if(unknown_label_index < far_label_index) {
+        cerr << "Error: unknown label : " << get_inst_str(&memory[unknown_label_index]) << endl;
+        exit(1);
+    }
+    else if(far_label_index != size_t(-1)) {
+        cerr << "Error: branch target is too far away for "
+             << get_inst_str(&memory[far_label_index]) << endl;
+        exit(1);
+    }
 
     // Labels are no longer needed.
     labels.clear();
+
+    // Cache the assembled program for later runs.
+    if(m_asm_cache) { save_asm_cache(cache_file, code_size, code_hash); }
 }
 
-// Parse an instruction string, and convert it to a Kite instruction.
-void inst_memory_t::parse_inst_str(std::string m_inst_str, size_t m_line_num) {
-    string inst_str = m_inst_str;
-
-    // Parse an instruction string.
-    vector<string> args;
-    while(inst_str.size()) {
-        // Get the next argument in the instruction string.
-        size_t l = inst_str.find_first_of(" \t,():");
-        // Append a colon symbol to the label.
-        l += (inst_str[l] == ':' ? 1 : 0);
-        args.push_back(inst_str.substr(0, l));
-        // Trim the string.
-        inst_str.erase(0, l);
-        inst_str.erase(0, inst_str.find_first_not_of(" \t,()"));
+// Load an assembled program from a cache, and return false if it is missing or stale.
+bool inst_memory_t::load_asm_cache(const string &m_cache_file, uint64_t m_code_size,
+                                   uint64_t m_code_hash) {
+    fstream file_stream;
+    file_stream.open(m_cache_file.c_str(), fstream::in | fstream::binary);
+    if(!file_stream.is_open()) { return false; }
+
+    // Check if the cache matches the program code.
+    asm_cache_header_t header;
+    if(!file_stream.read((char*)&header, sizeof(header)) ||
+       memcmp(header.magic, asm_cache_magic, sizeof(asm_cache_magic)) ||
+       (header.version != asm_cache_version) || (header.code_size != m_code_size) ||
+       (header.code_hash != m_code_hash) || !header.num_insts) {
+        return false;
+    }
+    vector<asm_cache_inst_t> records(header.num_insts);
+    string label_str(header.label_size, '\0');
+    if(!file_stream.read((char*)records.data(), records.size()*sizeof(asm_cache_inst_t)) ||
+       !file_stream.read(&label_str[0], label_str.size())) {
+        return false;
+    }
+
+    // Rebuild instructions. ALU latencies are derived from the opcodes so
+    // that the cache stays valid when the latency table changes.
+    vector<inst_t> insts(records.size());
+    size_t label_offset = 0;
+    for(size_t i = 0; i < records.size(); i++) {
+        const asm_cache_inst_t &record = records[i];
+        inst_t &inst = insts[i];
+        // A corrupt record is rejected so that the program is assembled
+        // from the source.
+        if((record.pc != (uint64_t(i) << 2)) ||
+           (record.op < 0) || (record.op >= num_kite_opcodes) ||
+           !is_cached_reg(record.rd_num) || !is_cached_reg(record.rs1_num) ||
+           !is_cached_reg(record.rs2_num) ||
+           (record.label_len > label_str.size() - label_offset)) {
+            return false;
+        }
+        inst.pc          = record.pc;
+        inst.op          = kite_opcode(record.op);
+        inst.rd_num      = record.rd_num;
+        inst.rs1_num     = record.rs1_num;
+        inst.rs2_num     = record.rs2_num;
+        inst.imm         = record.imm;
+        inst.label       = label_str.substr(label_offset, record.label_len);
+        inst.alu_latency = op_latency[inst.op];
+        label_offset += record.label_len;
+    }
+    memory.swap(insts);
+    return true;
+}
+
+// Save the assembled program to a cache. The cache is written to a
+// temporary file and renamed so that concurrent runs never read a partial
+// cache. A cache that cannot be written is silently skipped.
+void inst_memory_t::save_asm_cache(const string &m_cache_file, uint64_t m_code_size,
+                                   uint64_t m_code_hash) const {
+    vector<asm_cache_inst_t> records(memory.size());
+    string label_str;
+    for(size_t i = 0; i < memory.size(); i++) {
+        const inst_t &inst = memory[i];
+        asm_cache_inst_t &record = records[i];
+        record.pc        = inst.pc;
+        record.imm       = inst.imm;
+        record.op        = inst.op;
+        record.rd_num    = inst.rd_num;
+        record.rs1_num   = inst.rs1_num;
+        record.rs2_num   = inst.rs2_num;
+        record.label_len = inst.label.size();
+        record.reserved  = 0;
+        label_str += inst.label;
     }
+    asm_cache_header_t header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, asm_cache_magic, sizeof(asm_cache_magic));
+    header.version    = asm_cache_version;
+    header.code_size  = m_code_size;
+    header.code_hash  = m_code_hash;
+    header.num_insts  = records.size();
+    header.label_size = label_str.size();
 
-    // Check if args have a label.
-    string lbl = args[0];
-    if(lbl[lbl.size()-1] == ':') {
+    stringstream tmp_file;
+    tmp_file << m_cache_file << "." << getpid();
+    fstream file_stream;
+    file_stream.open(tmp_file.str().c_str(), fstream::out | fstream::binary | fstream::trunc);
+    if(!file_stream.is_open()) { return; }
+    file_stream.write((const char*)&header, sizeof(header));
+    file_stream.write((const char*)records.data(), records.size()*sizeof(asm_cache_inst_t));
+    file_stream.write(label_str.data(), label_str.size());
+    file_stream.close();
+    if(!file_stream || rename(tmp_file.str().c_str(), m_cache_file.c_str())) {
+        unlink(tmp_file.str().c_str());
+    }
+}
+
+// Set the PC-relative distance of a branch or jump instruction to its label.
+void inst_memory_t::resolve_label(size_t m_index, int64_t m_pc) {
+    inst_t &inst = memory[m_index];
+    // PC-relative distance
+    inst.imm = (m_pc - int64_t(inst.pc)) >> 1;
+    // Check if the PC-relative distance fits into the immediate field of instruction.
+    unsigned imm_width = (get_op_type(inst.op) == op_sb_type ? 12 : 20) - 1;
+    if((inst.imm >= 0 ? inst.imm >> imm_width : (inst.imm >> imm_width) != -1) &&
+       (m_index < far_label_index)) {
+        far_label_index = m_index;
+    }
+}
+
+// Parse an instruction line, and convert it to a Kite instruction.
+void inst_memory_t::parse_inst(const char *m_line, const char *m_end, size_t m_line_num) {
+    // Split the line into tokens. A token ends at a delimiter, and a colon
+    // delimiter is kept in the token to mark a label.
+    asm_token_t tokens[max_asm_tokens] = {};
+    size_t num_tokens = 0;
+    for(const char *str = m_line; str < m_end;) {
+        const char *token_end = str;
+        while((token_end < m_end) && !is_token_delim(*token_end)) { token_end++; }
+        if((token_end < m_end) && (*token_end == ':')) { token_end++; }
+        if(num_tokens < max_asm_tokens) {
+            tokens[num_tokens].str = str;
+            tokens[num_tokens].len = token_end - str;
+        }
+        num_tokens++;
+        for(str = token_end; (str < m_end) && is_token_space(*str); str++) {}
+    }
+
+    // Check if the line has a label.
+    asm_token_t *args = tokens;
+    size_t num_args = num_tokens;
+    if(args[0].len && (args[0].str[args[0].len-1] == ':')) {
+        // Record the PC of the label, and resolve instructions waiting for it.
+        string lbl = lower_str(args[0].str, args[0].len-1);
+        int64_t pc = memory.size() << 2;
+        unordered_map<string, label_t>::iterator it = labels.find(lbl);
+        if(it == labels.end()) { labels[lbl].pc = pc; }
+        else if(it->second.pc < 0) {
+            it->second.pc = pc;
+            for(size_t i = 0; i < it->second.fixups.size(); i++) {
+                resolve_label(it->second.fixups[i], pc);
+            }
+            it->second.fixups.clear();
+        }
         // Remove the label from args.
-        args.erase(args.begin());
-        // Record a pair of label and PC in the map.
-        labels.insert(pair<string, int64_t>(lbl.substr(0, lbl.size()-1), memory.size()<<2));
+        args++; num_args--;
     }
     // Line has no instruction but only a label.
-    if(!args.size()) { return; }
+    if(!num_args) { return; }
 
     inst_t inst;
     // Set the PC of instruction.
     inst.pc = memory.size() << 2;
 
     // Get the opcode of instruction.
-    inst.op = get_opcode(args[0]);
+    inst.op = lookup_opcode(args[0].str, args[0].len);
     if(inst.op >= num_kite_opcodes) {
-        cerr << "Error: unknown opcode " << args[0]
+        cerr << "Error: unknown opcode " << lower_str(args[0].str, args[0].len)
              << " at line #" << m_line_num << endl;
         exit(1);
     }
 
     // Set an ALU execution latency.
-    inst.alu_latency = get_op_latency(inst.op);
+    inst.alu_latency = op_latency[inst.op];
 
     // Decode the instruction based on its type.
     switch(get_op_type(inst.op)) {
         case op_r_type: {
             // R-type format: op rd, rs1, rs2
-            if(args.size() != 4) {
-                cerr << "Error: incomplete instruction: " << m_inst_str
+            if(num_args != 4) {
+                cerr << "Error: incomplete instruction: " << lower_str(m_line, m_end - m_line)
                      << " at line #" << m_line_num << endl;
                 exit(1);
             }
-            if(!is_reg_str(args[1]) || !is_reg_str(args[2]) || !is_reg_str(args[3])) {
-                cerr << "Error: invalid instruction format: " << m_inst_str
+            if(!is_reg_token(args[1]) || !is_reg_token(args[2]) || !is_reg_token(args[3])) {
+                cerr << "Error: invalid instruction format: " << lower_str(m_line, m_end - m_line)
                      << " at line #" << m_line_num << endl;
                 exit(1);
             }
-            inst.rd_num  = get_regnum(args[1]);
-            inst.rs1_num = get_regnum(args[2]);
-            inst.rs2_num = get_regnum(args[3]);
+            inst.rd_num  = lookup_regnum(args[1].str, args[1].len);
+            inst.rs1_num = lookup_regnum(args[2].str, args[2].len);
+            inst.rs2_num = lookup_regnum(args[3].str, args[3].len);
             break;
         }
         case op_i_type: {
-            if(args.size() != 4) {
-                cerr << "Error: incomplete instruction: " << m_inst_str
+            if(num_args != 4) {
+                cerr << "Error: incomplete instruction: " << lower_str(m_line, m_end - m_line)
                      << " at line #" << m_line_num << endl;
                 exit(1);
             }
             if((inst.op == op_jalr) || (inst.op == op_ld)) {
                 // jalr and ld format: op rd, imm(rs1)
-                if(!is_reg_str(args[1]) || !is_num_str(args[2]) || !is_reg_str(args[3])) {
-                    cerr << "Error: invalid instruction format: " << m_inst_str
+                if(!is_reg_token(args[1]) || !is_num_token(args[2]) || !is_reg_token(args[3])) {
+                    cerr << "Error: invalid instruction format: " << lower_str(m_line, m_end - m_line)
                          << " at line #" << m_line_num << endl;
                     exit(1);
                 }
-                inst.rd_num  = get_regnum(args[1]);
-                inst.imm     = get_imm(args[2]);
-                inst.rs1_num = get_regnum(args[3]);
+                inst.rd_num  = lookup_regnum(args[1].str, args[1].len);
+                inst.imm     = get_token_imm(args[2]);
+                inst.rs1_num = lookup_regnum(args[3].str, args[3].len);
             }
             else {
                 // I-type format: op rd, rs1, imm
-                if(!is_reg_str(args[1]) || !is_reg_str(args[2]) || !is_num_str(args[3])) {
-                    cerr << "Error: invalid instruction format: " << m_inst_str
+                if(!is_reg_token(args[1]) || !is_reg_token(args[2]) || !is_num_token(args[3])) {
+                    cerr << "Error: invalid instruction format: " << lower_str(m_line, m_end - m_line)
                          << " at line #" << m_line_num << endl;
                     exit(1);
                 }
-                inst.rd_num  = get_regnum(args[1]);
-                inst.rs1_num = get_regnum(args[2]);
-                inst.imm = get_imm(args[3]);
+                inst.rd_num  = lookup_regnum(args[1].str, args[1].len);
+                inst.rs1_num = lookup_regnum(args[2].str, args[2].len);
+                inst.imm = get_token_imm(args[3]);
             }
             // Check if the immediate value fits into 12 bits.
             if(inst.imm >= 0 ? inst.imm >> 11 : (inst.imm >> 11) != -1) {
-                cerr << "Error: invalid immediate value: " << m_inst_str
+                cerr << "Error: invalid immediate value: " << lower_str(m_line, m_end - m_line)
                      << " at line #" << m_line_num << endl;
                 exit(1);
             }
@@ -186,61 +412,61 @@ void inst_memory_t::parse_inst_str(std::string m_inst_str, size_t m_line_num) {
         }
         case op_s_type: {
             // S-type format: op rs2, imm(rs1)
-            if(args.size() != 4) {
-                cerr << "Error: incomplete instruction: " << m_inst_str
+            if(num_args != 4) {
+                cerr << "Error: incomplete instruction: " << lower_str(m_line, m_end - m_line)
                      << " at line #" << m_line_num << endl;
                 exit(1);
             }
-            if(!is_reg_str(args[1]) || !is_num_str(args[2]) || !is_reg_str(args[3])) {
-                cerr << "Error: invalid instruction format: " << m_inst_str
+            if(!is_reg_token(args[1]) || !is_num_token(args[2]) || !is_reg_token(args[3])) {
+                cerr << "Error: invalid instruction format: " << lower_str(m_line, m_end - m_line)
                      << " at line #" << m_line_num << endl;
                 exit(1);
             }
-            inst.rs2_num = get_regnum(args[1]);
-            inst.imm     = get_imm(args[2]);
+            inst.rs2_num = lookup_regnum(args[1].str, args[1].len);
+            inst.imm     = get_token_imm(args[2]);
             // Check if the immediate value fits into 12 bits.
             if(inst.imm >= 0 ? inst.imm >> 11 : (inst.imm >> 11) != -1) {
-                cerr << "Error: invalid immediate value: " << m_inst_str
+                cerr << "Error: invalid immediate value: " << lower_str(m_line, m_end - m_line)
                      << " at line #" << m_line_num << endl;
                 exit(1);
             }
-            inst.rs1_num = get_regnum(args[3]);
+            inst.rs1_num = lookup_regnum(args[3].str, args[3].len);
             break;
         }
         case op_sb_type: {
             // SB-type format: op rs1, rs2, label
-            if(args.size() != 4) {
-                cerr << "Error: incomplete instruction: " << m_inst_str
+            if(num_args != 4) {
+                cerr << "Error: incomplete instruction: " << lower_str(m_line, m_end - m_line)
                      << " at line #" << m_line_num << endl;
                 exit(1);
             }
-            if(!is_reg_str(args[1]) || !is_reg_str(args[2])) {
-                cerr << "Error: invalid instruction format: " << m_inst_str
+            if(!is_reg_token(args[1]) || !is_reg_token(args[2])) {
+                cerr << "Error: invalid instruction format: " << lower_str(m_line, m_end - m_line)
                      << " at line #" << m_line_num << endl;
                 exit(1);
             }
-            inst.rs1_num = get_regnum(args[1]);
-            inst.rs2_num = get_regnum(args[2]);
-            inst.label   = args[3];
+            inst.rs1_num = lookup_regnum(args[1].str, args[1].len);
+            inst.rs2_num = lookup_regnum(args[2].str, args[2].len);
+            inst.label   = lower_str(args[3].str, args[3].len);
             break;
         }
         case op_u_type: {
             // U-type format: op rd, imm
-            if(args.size() != 3) {
-                cerr << "Error: incomplete instruction: " << m_inst_str
+            if(num_args != 3) {
+                cerr << "Error: incomplete instruction: " << lower_str(m_line, m_end - m_line)
                      << " at line #" << m_line_num << endl;
                 exit(1);
             }
-            if(!is_reg_str(args[1]) || !is_num_str(args[2])) {
-                cerr << "Error: invalid instruction format: " << m_inst_str
+            if(!is_reg_token(args[1]) || !is_num_token(args[2])) {
+                cerr << "Error: invalid instruction format: " << lower_str(m_line, m_end - m_line)
                      << " at line #" << m_line_num << endl;
                 exit(1);
             }
-            inst.rd_num = get_regnum(args[1]);
-            inst.imm    = get_imm(args[2]);
+            inst.rd_num = lookup_regnum(args[1].str, args[1].len);
+            inst.imm    = get_token_imm(args[2]);
             // Check if the immediate value fits into 20 bits.
             if(inst.imm >= 0 ? inst.imm >> 19 : (inst.imm >> 19) != -1) {
-                cerr << "Error: invalid immediate value: " << m_inst_str
+                cerr << "Error: invalid immediate value: " << lower_str(m_line, m_end - m_line)
                      << " at line #" << m_line_num << endl;
                 exit(1);
             }
@@ -248,18 +474,18 @@ void inst_memory_t::parse_inst_str(std::string m_inst_str, size_t m_line_num) {
         }
         case op_uj_type: {
             // UL-type format: op rd, label
-            if(args.size() != 3) {
-                cerr << "Error: incomplete instruction: " << m_inst_str
+            if(num_args != 3) {
+                cerr << "Error: incomplete instruction: " << lower_str(m_line, m_end - m_line)
                      << " at line #" << m_line_num << endl;
                 exit(1);
             }
-            if(!is_reg_str(args[1])) {
-                cerr << "Error: invalid instruction format: " << m_inst_str
+            if(!is_reg_token(args[1])) {
+                cerr << "Error: invalid instruction format: " << lower_str(m_line, m_end - m_line)
                      << " at line #" << m_line_num << endl;
                 exit(1);
             }
-            inst.rd_num  = get_regnum(args[1]);
-            inst.label   = args[2];
+            inst.rd_num  = lookup_regnum(args[1].str, args[1].len);
+            inst.label   = lower_str(args[2].str, args[2].len);
             break;
         }
         default: { break; } // Nothing to do
@@ -267,5 +493,16 @@ void inst_memory_t::parse_inst_str(std::string m_inst_str, size_t m_line_num) {
 
     // Store instruction in memory.
     memory.push_back(inst);
+
+    // Resolve the label of a branch or jump, or wait for the label definition.
+    if((get_op_type(inst.op) == op_sb_type) || (get_op_type(inst.op) == op_uj_type)) {
+        unordered_map<string, label_t>::iterator it = labels.find(inst.label);
+        if(it == labels.end()) {
+            it = labels.insert(make_pair(inst.label, label_t())).first;
+            it->second.pc = -1;
+        }
+        if(it->second.pc >= 0) { resolve_label(memory.size()-1, it->second.pc); }
+        else { it->second.fixups.push_back(memory.size()-1); }
+    }
 }
 
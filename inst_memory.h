@@ -1,29 +1,74 @@
 #ifndef __KITE_INST_MEMORY_H__
 #define __KITE_INST_MEMORY_H__
 
-#include <map>
+#include <string>
+#include <unordered_map>
 #include <vector>
 #include "inst.h"
 
 class core_t;
 
+// An assembled program is cached next to its source as <program_code>.kcache.
+// The cache holds a header, one record per instruction, and the label strings
+// of branches and jumps. It is valid only for a source of the same size and
+// content hash (64-bit FNV-1a).
+#define asm_cache_suffix    ".kcache"
+#define asm_cache_magic     "KITEASM"
+#define asm_cache_version   1
+
+// Program cache header
+struct asm_cache_header_t {
+    char magic[8];                          // Magic string
+    uint64_t version;                       // Cache format version
+    uint64_t code_size;                     // Size of the program code
+    uint64_t code_hash;                     // Content hash of the program code
+    uint64_t num_insts;                     // Number of instructions
+    uint64_t label_size;                    // Total length of label strings
+};
+
+// Program cache record of an instruction
+struct asm_cache_inst_t {
+    uint64_t pc;                            // Program counter
+    int64_t imm;                            // Immediate
+    int32_t op;                             // Instruction operation
+    int32_t rd_num, rs1_num, rs2_num;       // Register operand indices
+    uint32_t label_len;                     // Label length
+    uint32_t reserved;                      // Padding
+};
+
+// Code label
+struct label_t {
+    int64_t pc;                             // PC of the label (-1 if not yet defined)
+    std::vector<size_t> fixups;             // Instructions waiting for the label definition
+};
+
 // Instruction memory
 class inst_memory_t {
 public:
-    inst_memory_t(const char *m_program_code);
+    inst_memory_t(const char *m_program_code, bool m_asm_cache = true,
+                  const uint64_t *m_op_latency = 0);
     ~inst_memory_t();
 
     inst_t* read(uint64_t m_pc);            // Read an instruction from memory.
+    const inst_t* peek(uint64_t m_pc) const;    // Get an instruction in memory without copying it.
     size_t num_insts() const;               // Get the total number of instructions in memory.
 
 private:
     // Load a program code.
-    void load_program_code(const char *m_program_code);
-    // Parse instruction string, and convert it to Kite instruction.
-    void parse_inst_str(std::string m_inst_str, size_t m_line_num);
+    void load_program_code(const char *m_program_code, bool m_asm_cache);
+    // Load an assembled program from a cache, and return false if it is missing or stale.
+    bool load_asm_cache(const std::string &m_cache_file, uint64_t m_code_size, uint64_t m_code_hash);
+    // Save the assembled program to a cache.
+    void save_asm_cache(const std::string &m_cache_file, uint64_t m_code_size, uint64_t m_code_hash) const;
+    // Parse an instruction line, and convert it to a Kite instruction.
+    void parse_inst(const char *m_line, const char *m_end, size_t m_line_num);
+    // Set the PC-relative distance of a branch or jump instruction to its label.
+    void resolve_label(size_t m_index, int64_t m_pc);
 
     std::vector<inst_t> memory;             // Instruction memory
-    std::map<std::string, int64_t> labels;  // Code labels
+    std::unordered_map<std::string, label_t> labels;   // Code labels
+    size_t far_label_index;                 // First instruction whose label is too far away
+    unsigned op_latency[num_kite_opcodes];  // ALU latency per instruction
 };
 
 #endif
@@ -1,8 +1,19 @@
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
+#include "config.h"
+#include "data_memory.h"
 #include "proc.h"
+#include "trace.h"
 
 using namespace std;
 
+// Get the value of a --key=value option, or return null if the key does not match.
+static const char* get_option(const char *m_arg, const char *m_key) {
+    size_t len = strlen(m_key);
+    return (!strncmp(m_arg, m_key, len) && (m_arg[len] == '=')) ? m_arg + len + 1 : 0;
+}
+
 static string banner = "\
 ************************************************************\n\
 * Kite: Architecture Simulator for RISC-V Instruction Set  *\n\
@@ -15,14 +26,131 @@ static string banner = "\
 int main(int argc, char **argv) {
     cout << banner << endl;
 
-    if(argc != 2) {
-        cerr << "Usage: " << argv[0] << " [program_code]" << endl;
+    // Convert a text memory state file to a binary memory image.
+    if((argc > 1) && (string(argv[1]) == "--convert-mem")) {
+        if(argc != 4) {
+            cerr << "Usage: " << argv[0] << " --convert-mem [mem_state] [mem_image]" << endl;
+            exit(1);
+        }
+        uint64_t ticks = 0;
+        data_memory_t data_memory(&ticks, 0, 0, 0, false, argv[2]);
+        data_memory.save_mem_image(argv[3]);
+        cout << "Converted " << argv[2] << " to memory image " << argv[3] << endl;
+        return 0;
+    }
+    // Convert a binary pipeline trace to the Konata pipeline viewer format.
+    if((argc > 1) && (string(argv[1]) == "--convert-trace")) {
+        if(argc != 4) {
+            cerr << "Usage: " << argv[0] << " --convert-trace [trace] [konata_log]" << endl;
+            exit(1);
+        }
+        convert_trace(argv[2], argv[3]);
+        cout << "Converted " << argv[2] << " to pipeline view " << argv[3] << endl;
+        return 0;
+    }
+
+    // Parse command-line options.
+    const char *config_file = 0;
+    vector<string> programs;                // Program of each hardware thread
+    vector<pair<string, string> > params;   // Parameters that override the config file
+    const char *stats_summary = 0, *stats_dump = 0, *value = 0;
+    const char *trace_file = 0, *profile_file = 0;
+    uint64_t stats_interval = 0, trace_start = 0, trace_end = 0;
+    bool inst_interval = false, host_stats = false;
+    for(int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        char *end = 0;
+        // Flags are shorthands of parameters.
+        if(arg == "--data-fwd") { params.push_back(make_pair("pipeline.data_fwd", "true")); }
+        else if(arg == "--br-pred") { params.push_back(make_pair("pipeline.br_pred", "true")); }
+        else if(arg == "--debug") { params.push_back(make_pair("pipeline.debug", "true")); }
+        else if(arg == "--stack-dist") { params.push_back(make_pair("stack_dist.enabled", "true")); }
+        else if(arg == "--vm") { params.push_back(make_pair("mmu.enabled", "true")); }
+        else if(arg == "--dram") { params.push_back(make_pair("dram.enabled", "true")); }
+        else if(arg == "--no-asm-cache") { params.push_back(make_pair("program.asm_cache", "false")); }
+        else if(arg == "--fusion") { params.push_back(make_pair("pipeline.fusion", "true")); }
+        else if(arg == "--value-pred") { params.push_back(make_pair("vp.enabled", "true")); }
+        else if(arg == "--functional-first") { params.push_back(make_pair("func_sim.enabled", "true")); }
+        else if((value = get_option(argv[i], "--victim-entries"))) {
+            params.push_back(make_pair("dcache.victim_entries", value));
+        }
+        else if((value = get_option(argv[i], "--capture"))) { params.push_back(make_pair("program.capture", value)); }
+        else if((value = get_option(argv[i], "--replay"))) { params.push_back(make_pair("program.replay", value)); }
+        else if((value = get_option(argv[i], "--config"))) { config_file = value; }
+        else if(arg == "--host-stats") { host_stats = true; }
+        else if((value = get_option(argv[i], "--stats"))) { stats_summary = value; }
+        else if((value = get_option(argv[i], "--stats-dump"))) { stats_dump = value; }
+        else if((value = get_option(argv[i], "--stats-interval")) ||
+                (value = get_option(argv[i], "--stats-interval-insts"))) {
+            inst_interval = (arg.compare(0, 22, "--stats-interval-insts") == 0);
+            stats_interval = strtoull(value, &end, 10);
+            if(!*value || *end || !stats_interval) { programs.clear(); break; }
+        }
+        else if((value = get_option(argv[i], "--profile"))) { profile_file = value; }
+        else if((value = get_option(argv[i], "--trace"))) { trace_file = value; }
+        else if((value = get_option(argv[i], "--trace-start"))) {
+            trace_start = strtoull(value, &end, 10);
+            if(!*value || *end) { programs.clear(); break; }
+        }
+        else if((value = get_option(argv[i], "--trace-end"))) {
+            trace_end = strtoull(value, &end, 10);
+            if(!*value || *end) { programs.clear(); break; }
+        }
+        else if(arg[0] != '-') { programs.push_back(arg); }
+        // Any other --name=value option sets a parameter.
+        else if(!arg.compare(0, 2, "--") && (arg.find('=') != string::npos)) {
+            size_t l = arg.find('=');
+            params.push_back(make_pair(arg.substr(2, l-2), arg.substr(l+1)));
+        }
+        else { programs.clear(); break; }
+    }
+    if(!programs.size()) {
+        cerr << "Usage: " << argv[0] << " [--config=<file>] [--<parameter>=<value> ...]" << endl
+             << "       [--data-fwd] [--br-pred] [--debug]" << endl
+             << "       [--stack-dist] [--vm] [--dram] [--no-asm-cache] [--fusion] [--value-pred]" << endl
+             << "       [--victim-entries=<n>] [--functional-first] [--capture=<file>] [--replay=<file>]" << endl
+             << "       [--stats=<file.csv|file.json>] [--stats-dump=<file.csv|file.json>]" << endl
+             << "       [--stats-interval=<cycles>|--stats-interval-insts=<insts>]" << endl
+             << "       [--trace=<file>] [--trace-start=<cycle>] [--trace-end=<cycle>]" << endl
+             << "       [--profile=<file>] [--host-stats] [--smt.fetch_policy=<rr|icount|switch_on_miss>]" << endl
+             << "       [program_code ...]" << endl
+             << "       " << argv[0] << " --convert-mem [mem_state] [mem_image]" << endl
+             << "       " << argv[0] << " --convert-trace [trace] [konata_log]" << endl;
         exit(1);
     }
 
-    proc_t proc;            // Kite processor
-    proc.init(argv[1]);     // Processor initialization
-    proc.run();             // Processor runs.
+    // Load the config file, and apply the command-line parameters over it.
+    config_t config;
+    if(config_file) { config.load(config_file); }
+    for(size_t i = 0; i < params.size(); i++) {
+        if(!config.set(params[i].first, params[i].second)) {
+            cerr << "Error: unknown parameter " << params[i].first << endl;
+            exit(1);
+        }
+    }
+    config.validate();
+    // Multiple programs run as hardware threads in separate data memory spaces.
+    if(programs.size() > 1) {
+        const char *error = config.vm ? "mmu.enabled" : config.func_sim ? "func_sim.enabled" :
+                            config.capture.size() ? "program.capture" :
+                            config.replay.size() ? "program.replay" : profile_file ? "--profile" :
+                            trace_file ? "--trace" : 0;
+        if(error) {
+            cerr << "Error: " << error << " cannot be used with multiple programs" << endl;
+            exit(1);
+        }
+    }
+
+    proc_base_t *proc = new_proc(&config);  // Kite processor
+    proc->init(programs, &config);          // Processor initialization
+    if(stats_dump && !stats_interval) { stats_interval = 100000; }
+    proc->set_stats_output(stats_summary, stats_dump,   // Stats output files
+                           stats_interval, inst_interval);
+    if(trace_file) { proc->set_trace(trace_file, trace_start, trace_end); }
+    if(profile_file) { proc->set_profile(profile_file); }
+    proc->set_host_stats(host_stats);
+    proc->run();            // Processor runs.
+    delete proc;
     return 0;
 }
 
@@ -0,0 +1,254 @@
+#include <cstdlib>
+#include <iostream>
+#include "mmu.h"
+#include "stats.h"
+
+using namespace std;
+
+// Translation lookaside buffer (TLB)
+tlb_t::tlb_t(uint64_t *m_ticks, uint64_t m_num_entries, uint64_t m_ways) :
+    ticks(m_ticks),
+    num_sets(0),
+    num_ways(m_ways),
+    vpns(0),
+    ppns(0),
+    valid(0),
+    last_access(0),
+    num_accesses(0),
+    num_misses(0) {
+    // Check if the number of entries is a multiple of the number of ways.
+    if(!num_ways || !m_num_entries || (m_num_entries % num_ways)) {
+        cerr << "Error: number of TLB entries must be a multiple of ways" << endl;
+        exit(1);
+    }
+    num_sets = m_num_entries / num_ways;
+    // Allocate TLB entries.
+    vpns        = new uint64_t[m_num_entries]();
+    ppns        = new uint64_t[m_num_entries]();
+    valid       = new bool[m_num_entries]();
+    last_access = new uint64_t[m_num_entries]();
+}
+
+tlb_t::~tlb_t() {
+    // Deallocate the TLB entries.
+    delete [] vpns;
+    delete [] ppns;
+    delete [] valid;
+    delete [] last_access;
+}
+
+// Look up a virtual page number.
+bool tlb_t::lookup(uint64_t m_vpn, uint64_t &m_ppn) {
+    num_accesses++;
+    uint64_t base = (m_vpn % num_sets) * num_ways;
+    for(uint64_t i = base; i < base + num_ways; i++) {
+        if(valid[i] && (vpns[i] == m_vpn)) {
+            last_access[i] = *ticks;
+            m_ppn = ppns[i];
+            return true;
+        }
+    }
+    num_misses++;
+    return false;
+}
+
+// Insert a translation. An invalid entry is taken first, and otherwise the
+// least recently used entry is replaced.
+void tlb_t::insert(uint64_t m_vpn, uint64_t m_ppn) {
+    uint64_t base = (m_vpn % num_sets) * num_ways;
+    uint64_t entry = base;
+    for(uint64_t i = base; i < base + num_ways; i++) {
+        if(!valid[i]) { entry = i; break; }
+        if(last_access[i] < last_access[entry]) { entry = i; }
+    }
+    vpns[entry] = m_vpn;
+    ppns[entry] = m_ppn;
+    valid[entry] = true;
+    last_access[entry] = *ticks;
+}
+
+// Print TLB stats.
+void tlb_t::print_stats(const char *m_name) {
+    cout.precision(3);
+    cout << "    " << m_name << " miss rate = " << fixed
+         << (num_accesses ? double(num_misses) / double(num_accesses) : 0)
+         << " (" << num_misses << "/" << num_accesses << ")" << endl;
+    cout.precision(-1);
+}
+
+// Register TLB stats.
+void tlb_t::register_stats(stats_t *m_stats, const string &m_prefix) {
+    m_stats->add_counter(m_prefix + ".accesses", &num_accesses, "Number of accesses");
+    m_stats->add_counter(m_prefix + ".misses", &num_misses, "Number of misses");
+    m_stats->add_formula(m_prefix + ".miss_rate", m_prefix + ".misses", m_prefix + ".accesses",
+                         "Miss rate");
+}
+
+
+
+// Memory management unit (MMU)
+mmu_t::mmu_t(uint64_t *m_ticks, uint64_t m_dtlb_entries, uint64_t m_dtlb_ways,
+             uint64_t m_l2_tlb_entries, uint64_t m_l2_tlb_ways,
+             uint64_t m_l2_tlb_latency, uint64_t m_walk_latency, bool m_debug) :
+    ticks(m_ticks),
+    cache(0),
+    memory(0),
+    dtlb(0),
+    l2_tlb(0),
+    l2_tlb_latency(m_l2_tlb_latency),
+    walk_latency(m_walk_latency),
+    root(0),
+    state(walk_idle),
+    trans_inst(0),
+    level(0),
+    table(0),
+    ready_ticks(0),
+    start_ticks(0),
+    num_walks(0),
+    num_walk_cycles(0),
+    num_page_faults(0),
+    debug(m_debug) {
+    // Create the L1 data TLB and the optional L2 TLB.
+    dtlb = new tlb_t(ticks, m_dtlb_entries, m_dtlb_ways);
+    if(m_l2_tlb_entries) { l2_tlb = new tlb_t(ticks, m_l2_tlb_entries, m_l2_tlb_ways); }
+    // Page table entries are read by a load that does not belong to the program.
+    walk_inst.op = op_ld;
+    walk_inst.rd_num = walk_inst.rs1_num = 0;
+}
+
+mmu_t::~mmu_t() {
+    // Deallocate the TLBs.
+    delete dtlb;
+    delete l2_tlb;
+}
+
+// Connect to the data cache and memory, and allocate the root page table.
+void mmu_t::connect(data_cache_t *m_cache, data_memory_t *m_memory) {
+    cache = m_cache;
+    cache->set_walk_inst(&walk_inst);
+    memory = m_memory;
+    root = memory->alloc_page_frame();
+}
+
+// Translate the memory address of an instruction. A DTLB hit translates the
+// address immediately. Otherwise, the L2 TLB and page walker take over, and
+// the instruction waits until the MMU is no longer busy.
+bool mmu_t::translate(inst_t *m_inst) {
+    uint64_t vpn = m_inst->memory_addr >> page_offset_bits, ppn = 0;
+    // The page tables map only the virtual address space. A larger address
+    // would alias a lower page in the TLBs and page tables.
+    if(vpn >> (page_level_bits * page_table_levels)) {
+        cerr << "Error: page fault at virtual address " << m_inst->memory_addr
+             << " is out of bounds" << endl;
+        exit(1);
+    }
+    trans_inst = m_inst;
+    if(dtlb->lookup(vpn, ppn)) { finish(ppn); return true; }
+    if(l2_tlb) {
+        state = walk_l2_tlb;
+        ready_ticks = *ticks + l2_tlb_latency;
+    }
+    else { start_walk(); }
+    return false;
+}
+
+// Is MMU busy translating an address?
+bool mmu_t::is_busy() const { return state != walk_idle; }
+
+// Run the MMU.
+bool mmu_t::run() {
+    uint64_t vpn = trans_inst ? trans_inst->memory_addr >> page_offset_bits : 0;
+
+    // L2 TLB responds after its hit latency.
+    if((state == walk_l2_tlb) && (*ticks >= ready_ticks)) {
+        uint64_t ppn = 0;
+        if(l2_tlb->lookup(vpn, ppn)) { dtlb->insert(vpn, ppn); finish(ppn); }
+        else { start_walk(); }
+    }
+    // Issue a page table access to the data cache.
+    if((state == walk_issue) && (*ticks >= ready_ticks) && cache->is_free()) {
+        unsigned shift = page_level_bits * (page_table_levels - 1 - level);
+        walk_inst.memory_addr = table + (((vpn >> shift) & ((1 << page_level_bits) - 1)) << 3);
+        cache->read(&walk_inst);
+        state = walk_wait;
+    }
+    // The data cache has returned a page table entry.
+    if((state == walk_wait) && cache->is_free()) {
+        int64_t pte = walk_inst.rd_val;
+        if(!(pte & pte_valid)) {
+            // The page is not mapped yet. The page table is filled on demand
+            // as if an operating system handled the page fault. Data pages
+            // are identity-mapped, and page tables are allocated in the page
+            // table region of the memory above the virtual address space.
+            uint64_t ppn = 0;
+            if(level < page_table_levels - 1) { ppn = memory->alloc_page_frame() >> page_offset_bits; }
+            else {
+                ppn = vpn;
+                num_page_faults++;
+            }
+            pte = (ppn << pte_ppn_shift) | pte_valid;
+            memory->write_dword(walk_inst.memory_addr, pte);
+        }
+        uint64_t ppn = uint64_t(pte) >> pte_ppn_shift;
+        if(++level < page_table_levels) {
+            // Walk the next level of page table.
+            table = ppn << page_offset_bits;
+            state = walk_issue;
+            ready_ticks = *ticks + walk_latency;
+        }
+        else {
+            // Fill the TLBs with the translation.
+            num_walk_cycles += *ticks - start_ticks;
+            if(l2_tlb) { l2_tlb->insert(vpn, ppn); }
+            dtlb->insert(vpn, ppn);
+            finish(ppn);
+        }
+    }
+    return state != walk_idle;
+}
+
+// Start a page table walk from the root page table.
+void mmu_t::start_walk() {
+    num_walks++;
+    level = 0;
+    table = root;
+    state = walk_issue;
+    start_ticks = *ticks;
+    ready_ticks = *ticks + walk_latency;
+    if(debug) { cout << *ticks << " : page table walk : addr = " << trans_inst->memory_addr << endl; }
+}
+
+// Complete a translation by replacing the virtual address with a physical one.
+void mmu_t::finish(uint64_t m_ppn) {
+    trans_inst->memory_addr = (m_ppn << page_offset_bits) |
+                              (trans_inst->memory_addr & ((1 << page_offset_bits) - 1));
+    trans_inst = 0;
+    state = walk_idle;
+}
+
+// Print MMU stats.
+void mmu_t::print_stats() {
+    cout << endl << "MMU stats:" << endl;
+    dtlb->print_stats("DTLB");
+    if(l2_tlb) { l2_tlb->print_stats("L2 TLB"); }
+    cout << "    Number of page table walks = " << num_walks << endl;
+    cout << "    Number of page faults = " << num_page_faults << endl;
+    cout.precision(3);
+    cout << "    Page table walk cycles = " << num_walk_cycles << " (avg "
+         << fixed << (num_walks ? double(num_walk_cycles) / double(num_walks) : 0)
+         << " cycles per walk)" << endl;
+    cout.precision(-1);
+}
+// Register MMU stats.
+void mmu_t::register_stats(stats_t *m_stats, const string &m_prefix) {
+    dtlb->register_stats(m_stats, m_prefix + ".dtlb");
+    if(l2_tlb) { l2_tlb->register_stats(m_stats, m_prefix + ".l2_tlb"); }
+    m_stats->add_counter(m_prefix + ".walks", &num_walks, "Number of page table walks");
+    m_stats->add_counter(m_prefix + ".walk_cycles", &num_walk_cycles,
+                         "Cycles spent in page table walks");
+    m_stats->add_counter(m_prefix + ".page_faults", &num_page_faults,
+                         "Number of demand-mapped pages");
+    m_stats->add_formula(m_prefix + ".avg_walk_cycles", m_prefix + ".walk_cycles",
+                         m_prefix + ".walks", "Average cycles per page table walk");
+}
+
@@ -0,0 +1,90 @@
+#ifndef __KITE_MMU_H__
+#define __KITE_MMU_H__
+
+#include <cstdint>
+#include "data_cache.h"
+#include "data_memory.h"
+#include "inst.h"
+
+// Page size and page table format. The radix page table has three levels of
+// 512 eight-byte entries per page, which covers a 39-bit virtual address
+// space. A page table entry holds a physical page number above bit 10 and a
+// valid flag at bit 0.
+#define page_offset_bits    12
+#define page_level_bits     9
+#define page_table_levels   3
+#define pte_ppn_shift       10
+#define pte_valid           0b1
+
+// Translation lookaside buffer (TLB)
+class tlb_t {
+public:
+    tlb_t(uint64_t *m_ticks, uint64_t m_num_entries, uint64_t m_ways = 1);
+    ~tlb_t();
+
+    bool lookup(uint64_t m_vpn, uint64_t &m_ppn);   // Look up a virtual page number.
+    void insert(uint64_t m_vpn, uint64_t m_ppn);    // Insert a translation.
+    void print_stats(const char *m_name);           // Print TLB stats.
+    void register_stats(stats_t *m_stats, const std::string &m_prefix);   // Register stats.
+
+private:
+    uint64_t *ticks;                                // Pointer to processor clock ticks
+    uint64_t num_sets;                              // Number of sets
+    uint64_t num_ways;                              // N-way set-associative TLB
+    uint64_t *vpns;                                 // Virtual page numbers
+    uint64_t *ppns;                                 // Physical page numbers
+    bool *valid;                                    // Valid flags
+    uint64_t *last_access;                          // Last access cycles
+
+    uint64_t num_accesses;                          // Number of accesses
+    uint64_t num_misses;                            // Number of misses
+};
+
+// Memory management unit (MMU)
+class mmu_t {
+public:
+    mmu_t(uint64_t *m_ticks, uint64_t m_dtlb_entries, uint64_t m_dtlb_ways,
+          uint64_t m_l2_tlb_entries = 0, uint64_t m_l2_tlb_ways = 1,
+          uint64_t m_l2_tlb_latency = 4, uint64_t m_walk_latency = 1, bool m_debug = false);
+    ~mmu_t();
+
+    // Connect to the data cache for page walks and to the memory holding page tables.
+    void connect(data_cache_t *m_cache, data_memory_t *m_memory);
+    bool translate(inst_t *m_inst);                 // Translate a memory address, and return true on a DTLB hit.
+    bool is_busy() const;                           // Is MMU busy translating an address?
+    bool run();                                     // Run the MMU, and return true when busy.
+    void print_stats();                             // Print MMU stats.
+    void register_stats(stats_t *m_stats, const std::string &m_prefix);   // Register stats.
+
+private:
+    void start_walk();                              // Start a page table walk.
+    void finish(uint64_t m_ppn);                    // Complete a translation.
+
+    // Page walker state
+    enum walk_state_t { walk_idle = 0, walk_l2_tlb, walk_issue, walk_wait };
+
+    uint64_t *ticks;                                // Pointer to processor clock ticks
+    data_cache_t *cache;                            // Data cache for page table accesses
+    data_memory_t *memory;                          // Memory holding page tables
+    tlb_t *dtlb;                                    // L1 data TLB
+    tlb_t *l2_tlb;                                  // L2 TLB (optional)
+    uint64_t l2_tlb_latency;                        // L2 TLB hit latency
+    uint64_t walk_latency;                          // Page walker latency per level
+    uint64_t root;                                  // Physical address of the root page table
+
+    walk_state_t state;                             // Page walker state
+    inst_t *trans_inst;                             // Memory instruction being translated
+    inst_t walk_inst;                               // Page table load issued to the data cache
+    unsigned level;                                 // Current page table level
+    uint64_t table;                                 // Physical address of the current page table
+    uint64_t ready_ticks;                           // Ticks that the next walk step can proceed
+    uint64_t start_ticks;                           // Ticks that the page table walk started
+
+    uint64_t num_walks;                             // Number of page table walks
+    uint64_t num_walk_cycles;                       // Cycles spent in page table walks
+    uint64_t num_page_faults;                       // Number of demand-mapped pages
+    bool debug;                                     // Print debug messages?
+};
+
+#endif
+
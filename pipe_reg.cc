@@ -1,7 +1,8 @@
 #include "pipe_reg.h"
 
 pipe_reg_t::pipe_reg_t() :
-    inst(0) {
+    inst(0),
+    bubble(cpi_frontend) {
 }
 
 pipe_reg_t::~pipe_reg_t() {
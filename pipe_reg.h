@@ -3,6 +3,23 @@
 
 #include "inst.h"
 
+// Cycle accounting buckets of the CPI stack. A cycle that retires no
+// instruction is charged to the cause of the bubble in the MEM/WB pipeline
+// register, and a stage that leaves its output register empty passes down
+// the cause of the bubble.
+enum cpi_bucket {
+    cpi_base = 0,                   // An instruction retires.
+    cpi_data_hazard,                // Decode waits for a non-load producer.
+    cpi_load_use,                   // Decode waits for a load.
+    cpi_alu,                        // A multi-cycle ALU operation is in progress.
+    cpi_dcache,                     // Memory stage waits for the data cache or MMU.
+    cpi_branch,                     // Pipeline refills after a flush, or fetch waits for a branch.
+    cpi_frontend,                   // Nothing to fetch (pipeline fill and drain).
+    cpi_value,                      // Pipeline refills after a load value misprediction.
+    cpi_mem_order,                  // Pipeline refills after a load ran ahead of a store.
+    num_cpi_buckets,
+};
+
 // Pipeline register
 class pipe_reg_t {
 public:
@@ -13,9 +30,13 @@ public:
     void write(inst_t *m_inst);     // Write an instruction into the pipeline register.
     void clear();                   // Remove an instruction from the pipeline register.
     bool is_free();                 // Is the pipeline register free?
+    // The bubble cause is set and read every cycle, so the accessors are inlined.
+    void set_bubble(cpi_bucket m_cause) { bubble = m_cause; }   // Set the cause of a bubble.
+    cpi_bucket get_bubble() const { return bubble; }            // Get the cause of a bubble.
 
 private:
     inst_t *inst;                   // An instruction currently in the pipeline register
+    cpi_bucket bubble;              // Cause of a bubble when the register is empty
 };
 
 #endif
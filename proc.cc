@@ -1,61 +1,223 @@
+#include <chrono>
 #include <iomanip>
 #include <iostream>
+#include <sys/resource.h>
 #include "proc.h"
 
 using namespace std;
 
-proc_t::proc_t() :
+template <class fwd_t, class pred_t, class debug_t>
+proc_t<fwd_t, pred_t, debug_t>::proc_t() :
     stalls(0),
     num_insts(0),
-#ifdef BR_PRED
     num_br_predicts(0),
     num_br_mispredicts(0),
     num_br_tgt_mispredicts(0),
-#endif
     num_flushes(0),
+    fusion(false),
     ticks(0),
-    pc(4),  // The first instruction is loaded from PC = 4.
-    inst_memory(0),
+    next_seq(1),
+    decode_seq(0),
+    stats_summary(0),
+    config(0),
+    policy(fetch_round_robin),
+    fetch_tid(0),
     br_predictor(0),
     br_target_buffer(0),
-    reg_file(0),
     alu(0),
+    value_predictor(0),
     data_memory(0),
-    data_cache(0) {
+    data_cache(0),
+    store_buffer(0),
+    dram(0),
+    mmu(0),
+    stack_dist(0),
+    func_sim(0),
+    replay(0),
+    exec_source(0),
+    capture(0),
+    wrong_path(false),
+    trace(0),
+    profile(0),
+    profile_file(0),
+    branch_pc(0),
+    flush_ticks(0),
+    host_stats(false),
+    host_seconds(0),
+    mem_inst(0) {
+    for(unsigned i = 0; i < num_fusion_types; i++) { num_fused[i] = 0; }
+    for(unsigned i = 0; i < num_cpi_buckets; i++) { cpi_cycles[i] = 0; }
 }
 
-proc_t::~proc_t() {
+template <class fwd_t, class pred_t, class debug_t>
+proc_t<fwd_t, pred_t, debug_t>::~proc_t() {
+    // Close the traces, which read the instruction memory.
+    delete trace;
+    delete capture;
     // Deallocate datapath elements.
-    delete inst_memory;
+    for(size_t i = 0; i < contexts.size(); i++) {
+        delete contexts[i].inst_memory;
+        delete contexts[i].reg_file;
+    }
     delete br_predictor;
     delete br_target_buffer;
-    delete reg_file;
     delete alu;
+    delete value_predictor;
     delete data_memory;
+    delete store_buffer;
     delete data_cache;
+    delete dram;
+    delete mmu;
+    delete stack_dist;
+    delete func_sim;
+    delete replay;
+    delete profile;
 }
 
-// Processor initialization
-void proc_t::init(const char *m_program_code) {
-    inst_memory = new inst_memory_t(m_program_code);    // Create an instruction memory.
-    br_predictor = new br_predictor_t(0, 4, 0);         // Create a branch predictor.
-    br_target_buffer = new br_target_buffer_t(16);      // Create a branch target buffer.
-    reg_file = new reg_file_t();                        // Create a register file.
-    alu = new alu_t(&ticks);                            // Create an ALU.
+// Get the path of a state file in the directory of a program.
+static string get_state_file(const string &m_program, const char *m_name) {
+    size_t l = m_program.find_last_of('/');
+    return (l == string::npos ? string() : m_program.substr(0, l+1)) + m_name;
+}
 
-    data_memory = new data_memory_t(&ticks, min_memory_size,
-                      inst_memory->num_insts()<<2, 0);  // Create a data memory.
-    data_cache = new data_cache_t(&ticks, 1024, 8, 1);  // Create a data cache.
-    data_memory->connect(data_cache);                   // Connect the memory to cache.
+// Processor initialization with a program per hardware thread. The first
+// thread uses the register and memory state files of the configuration, and
+// the other threads use the state files in the directories of their programs.
+template <class fwd_t, class pred_t, class debug_t>
+void proc_t<fwd_t, pred_t, debug_t>::init(const vector<string> &m_programs, const config_t *m_config) {
+    config = m_config;
+    fusion = config->fusion;                            // Enable macro-op fusion.
+    policy = config->fetch_policy == "icount" ? fetch_icount :
+             config->fetch_policy == "switch_on_miss" ? fetch_switch_on_miss : fetch_round_robin;
+    // A replayed trace has no register or memory values, and the initial
+    // register and memory states are not loaded.
+    bool has_state = !config->replay.size();
+    contexts.resize(m_programs.size());
+    for(size_t i = 0; i < contexts.size(); i++) {
+        context_t &context = contexts[i];
+        context.inst_memory = new inst_memory_t(        // Create an instruction memory, and
+                                  m_programs[i].c_str(),    // cache the assembled program.
+                                  config->asm_cache, config->op_latency);
+        context.reg_file = new reg_file_t(!has_state ? 0 :  // Create a register file.
+                               i ? get_state_file(m_programs[i], "reg_state").c_str() :
+                                   config->reg_state.c_str());
+        context.pc           = 4;   // The first instruction is loaded from PC = 4.
+        context.mem_base     = uint64_t(i) << smt_mem_shift;
+        context.num_insts    = 0;
+        context.num_inflight = 0;
+    }
+    inst_memory_t *inst_memory = contexts[0].inst_memory;
+    br_predictor = new br_predictor_t(config->bht_bits, // Create a branch predictor.
+                      config->pht_bits, config->hist_len);
+    br_target_buffer = new br_target_buffer_t(config->btb_entries);    // Create a branch target buffer.
+    alu = new alu_t(&ticks, debug_t::enabled,           // Create an ALU with a pool of
+                    config->fu_alus, config->fu_muls,   // functional units.
+                    config->fu_divs, config->op_latency[op_mul], config->fu_div_bits);
+    if(config->vp) {
+        value_predictor = new value_predictor_t(        // Create a load value predictor.
+                              config->vp_type == "last" ? vp_last :
+                              config->vp_type == "context" ? vp_context : vp_stride,
+                              config->vp_entries, config->vp_confidence);
+    }
+
+    data_memory = new data_memory_t(&ticks,             // Create a data memory. Page tables
+                      inst_memory->num_insts()<<2,      // of virtual memory are placed above
+                      config->memory_latency,           // the virtual address space.
+                      config->vm ? uint64_t(1) << (page_offset_bits +
+                                   page_level_bits*page_table_levels) : 0,
+                      config->huge_pages, has_state ? config->mem_state.c_str() : 0,
+                      config->memory_queue_depth, config->memory_bandwidth,
+                      config->memory_in_order);
+    for(size_t i = 1; i < contexts.size(); i++) {      // Load the memory states of other threads.
+        data_memory->load_mem_state(get_state_file(m_programs[i], "mem_state").c_str(),
+                                    contexts[i].mem_base);
+    }
+    data_cache = new data_cache_t(&ticks,               // Create a data cache.
+                      config->dcache_size, config->dcache_block_size, config->dcache_ways,
+                      config->victim_entries, config->victim_latency, debug_t::enabled,
+                      !has_state);
+    if(config->sb_entries) {
+        store_buffer = new store_buffer_t(&ticks,       // Create a store buffer.
+                           data_cache, config->sb_entries, config->sb_store_sets,
+                           config->sb_ssit_entries, contexts.size());
+    }
+    if(config->dram) {
+        dram = new dram_t(&ticks,                       // Create a DRAM backend.
+                          config->dram_channels, config->dram_ranks, config->dram_banks,
+                          config->dram_row_size, config->dram_open_page,
+                          config->dram_t_rcd, config->dram_t_cas, config->dram_t_rp,
+                          config->dram_t_ras, config->dram_t_burst,
+                          config->dram_t_refi, config->dram_t_rfc);
+    }
+    data_memory->connect(dram);                         // Connect the memory to DRAM (if any).
     data_cache->connect(data_memory);                   // Connect the cache to memory.
+    if(config->vm) {
+        mmu = new mmu_t(&ticks,                         // Create an MMU.
+                        config->dtlb_entries, config->dtlb_ways,
+                        config->l2_tlb_entries, config->l2_tlb_ways,
+                        config->l2_tlb_latency, config->walk_latency, debug_t::enabled);
+        mmu->connect(data_cache, data_memory);          // Connect the MMU to cache and memory.
+    }
+    if(config->stack_dist) {
+        stack_dist = new stack_dist_t(                  // Create a stack distance analyzer
+                         config->dcache_block_size,     // with the data cache block size.
+                         config->stack_dist_set_bits, config->stack_dist_ways);
+    }
+    if(config->func_sim) {
+        func_sim = new func_sim_t(inst_memory,          // Create a functional model with its
+                       config->reg_state.c_str(),       // own registers and memory.
+                       config->mem_state.c_str(), config->huge_pages,
+                       config->func_sim_ring_entries);
+        exec_source = func_sim;
+    }
+    if(config->replay.size()) {                         // Replay an execution trace.
+        exec_source = replay = new exec_trace_reader_t(inst_memory, config->replay.c_str());
+    }
+    if(config->capture.size()) {                        // Capture an execution trace.
+        capture = new exec_trace_writer_t(inst_memory, config->capture.c_str());
+    }
+    register_stats();                                   // Register stats.
+}
+
+// Write a stats summary file, and dump stats every m_interval cycles or instructions.
+template <class fwd_t, class pred_t, class debug_t>
+void proc_t<fwd_t, pred_t, debug_t>::set_stats_output(const char *m_summary, const char *m_dump,
+                                                      uint64_t m_interval, bool m_inst_interval) {
+    stats_summary = m_summary;
+    if(m_dump) { stats.open_dump(m_dump, m_interval, m_inst_interval ? "proc.insts" : "proc.cycles"); }
+}
+
+// Profile the program per PC, and write a listing.
+template <class fwd_t, class pred_t, class debug_t>
+void proc_t<fwd_t, pred_t, debug_t>::set_profile(const char *m_file) {
+    profile = new profile_t(contexts[0].inst_memory);
+    profile_file = m_file;
+}
+
+// Print host throughput and memory usage.
+template <class fwd_t, class pred_t, class debug_t>
+void proc_t<fwd_t, pred_t, debug_t>::set_host_stats(bool m_host_stats) {
+    host_stats = m_host_stats;
+}
+
+// Trace pipeline events within the [m_start, m_end) cycle window.
+template <class fwd_t, class pred_t, class debug_t>
+void proc_t<fwd_t, pred_t, debug_t>::set_trace(const char *m_file, uint64_t m_start, uint64_t m_end) {
+    trace = new trace_t(&ticks, contexts[0].inst_memory, m_file, m_start, m_end);
 }
 
 // Run the processor pipeline.
-void proc_t::run() {
+template <class fwd_t, class pred_t, class debug_t>
+void proc_t<fwd_t, pred_t, debug_t>::run() {
     cout << "Start running ..." << endl;
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    // The functional model runs ahead of the pipeline on its own thread.
+    if(func_sim) { func_sim->start(); }
     while(!ticks || if_id_preg.read()  || id_ex_preg.read()  ||
                     ex_mem_preg.read() || mem_wb_preg.read() ||
-                    !alu->is_free()    || !data_cache->is_free()) {
+                    !alu->is_free()    || !data_cache->is_free() ||
+                    (store_buffer && !store_buffer->is_empty()) ||
+                    (mmu && mmu->is_busy())) {
         // Increment clock ticks.
         ticks++;
         // Process pipeline stages backwards.
@@ -64,193 +226,495 @@ void proc_t::run() {
         execute();
         decode();
         fetch();
+        // Dump stats at the end of an interval.
+        stats.sample();
     }
+    host_seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
     cout << "Done." << endl;
     // Print pipeline stats.
     print_stats();
+    // Dump the last interval, and write the stats summary.
+    stats.close_dump();
+    if(stats_summary) { stats.write_summary(stats_summary); }
+    // Write the per-PC profile listing.
+    if(profile) { profile->write_listing(profile_file, data_cache); }
 }
 
 // Writeback stage
-void proc_t::writeback() {
+template <class fwd_t, class pred_t, class debug_t>
+void proc_t<fwd_t, pred_t, debug_t>::writeback() {
     // Read an instruction from the MEM/WB pipeline register.
     inst_t *inst = mem_wb_preg.read();
+    // A cycle without a retiring instruction is charged to the cause of the bubble.
+    cpi_cycles[inst ? cpi_base : mem_wb_preg.get_bubble()]++;
     if(inst) {
+        context_t &context = contexts[inst->tid];
         // Update the number of executed instructions.
         num_insts++;
+        context.num_insts++;
+        context.num_inflight--;
+        if(trace) { trace->record(inst->seq, inst->pc, trace_writeback); }
+        if(profile) {
+            profile->get(inst->pc).count++;
+            if(inst->fused) { profile->get(inst->fused->pc).count++; }
+            // Cycles until the first instruction retires after a flush are
+            // lost to the mispredicted branch.
+            if(flush_ticks) {
+                profile->get(branch_pc).branch_cycles += ticks - flush_ticks - 1;
+                flush_ticks = 0;
+            }
+        }
         // Remove the instruction from the MEM/WB pipeline register.
         mem_wb_preg.clear();
+        // Record the committed instructions in the execution trace.
+        if(capture) {
+            capture->record(inst);
+            if(inst->fused) { capture->record(inst->fused); }
+        }
         // Write a result to the register file. Discard the x0 register.
         if(inst->rd_num > 0) {
-            reg_file->write(inst, inst->rd_num, inst->rd_val);
+            context.reg_file->write(inst, inst->rd_num, inst->rd_val);
+        }
+        // The second instruction of a fused pair retires with the first one.
+        inst_t *br_inst = inst;
+        if(inst->fused) {
+            num_insts++;
+            context.num_insts++;
+            num_fused[get_fusion_type(inst, inst->fused)]++;
+            br_inst = inst->fused;
+            if(br_inst->rd_num > 0) {
+                context.reg_file->write(br_inst, br_inst->rd_num, br_inst->rd_val);
+            }
+        }
+        if(debug_t::enabled) {
+            cout << ticks << " : writeback : " << get_inst_str(inst, true) << endl;
         }
-#ifdef DEBUG
-        cout << ticks << " : writeback : " << get_inst_str(inst, true) << endl;
-#endif
         // Update the branch predictor and branch target buffer for conditional branches.
-        if(inst->branch_target) {
-#ifdef BR_PRED
+        // Only the second instruction of a fused pair can be a branch.
+        if(br_inst->branch_target && pred_t::enabled) {
             num_br_predicts++;
-            br_predictor->update(inst);
-            if(inst->branch_taken) {
-                br_target_buffer->update(inst->pc, inst->branch_target);
+            br_predictor->update(br_inst);
+            if(br_inst->branch_taken) {
+                br_target_buffer->update(br_inst->pc, br_inst->branch_target);
             }
             // Predicted branch target and actual branch target are different.
             // Flush and restart the pipeline.
-            if(inst->pred_target != inst->branch_target) {
+            if(br_inst->pred_target != br_inst->branch_target) {
                 // A branch mis-prediction (i.e., direction) or target mis-prediction
                 // (i.e., address) needs to flush the pipeline.
-                inst->pred_taken != inst->branch_taken ? num_br_mispredicts++ :
-                                                         num_br_tgt_mispredicts++;
+                br_inst->pred_taken != br_inst->branch_taken ? num_br_mispredicts++ :
+                                                               num_br_tgt_mispredicts++;
+                if(profile) {
+                    profile->get(br_inst->pc).mispredicts++;
+                    branch_pc = br_inst->pc;
+                    flush_ticks = ticks;
+                }
                 // Flush the pipeline, and set the correct PC.
-                flush();
-                pc = inst->branch_target;
-#ifdef DEBUG
-                cout << ticks << " : pipeline flush : restart at PC = " << pc << endl;
-#endif
+                flush(inst->tid);
+                num_flushes++;
+                context.pc = br_inst->branch_target;
+                if(debug_t::enabled) {
+                    cout << ticks << " : pipeline flush : restart at PC = " << context.pc << endl;
+                }
             }
-#else       // No branch prediction is used. The next PC of a branch is set here to avoid
-            // speculative executions.
-            pc = inst->branch_target;
-#endif
         }
+        // No branch prediction is used. The next PC of a branch is set here to avoid
+        // speculative executions.
+        else if(br_inst->branch_target) { context.pc = br_inst->branch_target; }
         // Retire the instruction.
         delete inst;
     }
 }
 
 // Memory stage
-void proc_t::memory() {
-    static inst_t *mem_inst = 0;
+template <class fwd_t, class pred_t, class debug_t>
+void proc_t<fwd_t, pred_t, debug_t>::memory() {
     // Memory stage makes a progress only if the MEM/WB pipeline register is free.
     if(mem_wb_preg.is_free()) {
-        // An instruction is read from the EX/MEM pipeline register.
-        if(data_cache->is_free() && (mem_inst = ex_mem_preg.read())) {
+        // An instruction is read from the EX/MEM pipeline register. A load or
+        // store waits for the data cache. If there is a store buffer, a store
+        // waits for a free entry instead, and a load that takes the value of
+        // a buffered store does not wait for the cache. The address is not
+        // yet placed in the data memory space of the thread.
+        inst_t *inst = ex_mem_preg.read();
+        bool port_used = false;
+        if(!mem_inst && inst && !(mmu && mmu->is_busy()) &&
+           (!store_buffer ? data_cache->is_free() :
+            inst->op == op_sd ? store_buffer->can_push() :
+            (inst->op != op_ld) || data_cache->is_free() ||
+            (!mmu && store_buffer->can_forward(inst, inst->memory_addr +
+                                                         contexts[inst->tid].mem_base)))) {
             // Remove the instruction from the EX/MEM pipeline register.
+            mem_inst = inst;
             ex_mem_preg.clear();
-            // Access the data memory for a load or store.
-            if(mem_inst->op == op_ld) { data_cache->read(mem_inst); }
-            else if(mem_inst->op == op_sd) { data_cache->write(mem_inst); }
+            if(trace) { trace->record(mem_inst->seq, mem_inst->pc, trace_memory); }
+            if((mem_inst->op == op_ld) || (mem_inst->op == op_sd)) {
+                // Place the address in the data memory space of the thread.
+                if(contexts.size() > 1) {
+                    if(mem_inst->memory_addr >> smt_mem_shift) {
+                        cerr << "Error: memory address " << mem_inst->memory_addr
+                             << " of thread " << mem_inst->tid << " is out of bounds" << endl;
+                        exit(1);
+                    }
+                    mem_inst->memory_addr += contexts[mem_inst->tid].mem_base;
+                }
+                // Record the data address stream for stack distance analysis.
+                if(stack_dist) { stack_dist->access(mem_inst->memory_addr); }
+                // Translate the memory address. The data cache is accessed
+                // when the translation is done.
+                if(!mmu || mmu->translate(mem_inst)) { port_used = access_cache(mem_inst); }
+            }
         }
-        // Data cache is done with the instruction.
-        if(!data_cache->run()) {
+        // MMU is done with translating the address of the instruction.
+        else if(mmu && mmu->is_busy() && !mmu->run()) { port_used = access_cache(mem_inst); }
+        // Data cache is done with the instruction. A buffered store that waits
+        // for a miss holds the data cache, but not the memory stage.
+        bool cache_busy = data_cache->run() && !(store_buffer && store_buffer->is_draining());
+        if(!cache_busy && !(mmu && mmu->is_busy())) {
+            // A load that ran ahead of a buffered store to the same address is
+            // refetched with the instructions after it.
+            if(mem_inst && mem_inst->order_violation) {
+                unsigned tid = mem_inst->tid;
+                uint64_t pc = mem_inst->pc;
+                flush(tid, cpi_mem_order);
+                squash(mem_inst); mem_inst = 0;
+                contexts[tid].pc = pc;
+                if(debug_t::enabled) {
+                    cout << ticks << " : memory order violation : restart at PC = " << pc << endl;
+                }
+            }
+            // The loaded value is ready for forwarding.
+            if(fwd_t::enabled && mem_inst && (mem_inst->op == op_ld)) { mem_inst->rd_ready = true; }
+            // Check the predicted value of a load. The instructions after a
+            // mispredicted load may have used the value, and they are refetched.
+            if(value_predictor && mem_inst && (mem_inst->op == op_ld)) {
+                value_predictor->update(mem_inst);
+                if(mem_inst->val_speculated && (mem_inst->rd_val != mem_inst->pred_val)) {
+                    flush(mem_inst->tid, cpi_value);
+                    contexts[mem_inst->tid].reg_file->claim(mem_inst);
+                    contexts[mem_inst->tid].pc = mem_inst->pc + 4;
+                    if(debug_t::enabled) {
+                        cout << ticks << " : value misprediction : restart at PC = "
+                             << mem_inst->pc + 4 << endl;
+                    }
+                }
+            }
             // Write the instruction in the MEM/WB pipeline register.
             mem_wb_preg.write(mem_inst); mem_inst = 0;
         }
+        // The instruction is waiting for the data cache or MMU.
+        else if(profile && mem_inst) { profile->get(mem_inst->pc).mem_cycles++; }
+        // The oldest buffered store is written to the data cache if no load
+        // uses or waits for the cache.
+        if(store_buffer) {
+            inst_t *next_inst = ex_mem_preg.read();
+            store_buffer->run(!port_used && !(mem_inst && (mem_inst->op == op_ld)) &&
+                              !(next_inst && (next_inst->op == op_ld)));
+        }
+        // A bubble is caused by the data cache or MMU, or it comes from the execute stage.
+        if(mem_wb_preg.is_free()) {
+            mem_wb_preg.set_bubble(mem_inst || ex_mem_preg.read() ? cpi_dcache :
+                                   ex_mem_preg.get_bubble());
+        }
     }
-#ifdef DEBUG
-    inst_t *inst = mem_wb_preg.read();
-    if(inst) {
+    inst_t *inst = 0;
+    if(debug_t::enabled && (inst = mem_wb_preg.read())) {
         cout << ticks << " : memory : " << get_inst_str(inst, true) << endl;
     }
-#endif
+}
+
+// Access the data cache for a load or store, and return true if the data
+// cache port is used. With a store buffer, a store is buffered, and a load
+// may take the value of a buffered store.
+template <class fwd_t, class pred_t, class debug_t>
+bool proc_t<fwd_t, pred_t, debug_t>::access_cache(inst_t *m_inst) {
+    if(m_inst->op == op_ld) {
+        if(store_buffer && store_buffer->read(m_inst)) {
+            if(debug_t::enabled) {
+                cout << ticks << " : store forwarding : " << get_inst_str(m_inst, true) << endl;
+            }
+            return false;
+        }
+        data_cache->read(m_inst);
+        // A load that misses gives a confidently predicted value to its
+        // dependents. The value is checked when the load completes.
+        if(value_predictor) {
+            int64_t value = 0;
+            m_inst->val_predicted = value_predictor->predict(m_inst, value);
+            m_inst->pred_val = value;
+            if(m_inst->val_predicted && !data_cache->is_free() && (m_inst->rd_num > 0)) {
+                m_inst->val_speculated = true;
+                m_inst->rd_val   = value;
+                m_inst->rd_ready = true;
+                if(debug_t::enabled) {
+                    cout << ticks << " : value prediction : " << get_inst_str(m_inst, true) << endl;
+                }
+            }
+        }
+    }
+    else if(store_buffer) { store_buffer->push(m_inst); return false; }
+    else { data_cache->write(m_inst); }
+    return true;
 }
 
 // Execute stage
-void proc_t::execute() {
+template <class fwd_t, class pred_t, class debug_t>
+void proc_t<fwd_t, pred_t, debug_t>::execute() {
     inst_t *inst = 0;
     // Execution stage makes a progress only if the EX/MEM pipeline register is free.
     if(ex_mem_preg.is_free()) {
         // An instruction is read from the ID/EX pipeline register.
-        if((inst = id_ex_preg.read()) && alu->is_free()) {
+        if((inst = id_ex_preg.read()) && alu->can_run(inst)) {
             // Remove the instruction from the ID/EX pipeline register, and let the ALU
             // execute the instruction.
             id_ex_preg.clear();
             alu->run(inst);
+            if(trace) { trace->record(inst->seq, inst->pc, trace_execute); }
+            if(profile) {
+                unsigned latency = alu->get_latency(inst);
+                if(inst->fused && (inst->fused->alu_latency > latency)) { latency = inst->fused->alu_latency; }
+                profile->get(inst->pc).alu_cycles += latency - 1;
+            }
         }
         // ALU is done with the instruction.
         if((inst = alu->get_output())) {
+            // Mark the rd value of instruction is ready for forwarding.
+            // The rd value of ld instruction becomes ready in the memory stage.
+            if(fwd_t::enabled) {
+                if((inst->rd_num > 0) && (inst->op != op_ld)) { inst->rd_ready = true; }
+                if(inst->fused && (inst->fused->rd_num > 0)) { inst->fused->rd_ready = true; }
+            }
             // Write the instruction in the EX/MEM pipeline register.
             ex_mem_preg.write(inst);
         }
+        // A bubble is caused by a multi-cycle ALU operation, or it comes from decode.
+        else {
+            ex_mem_preg.set_bubble(!alu->is_free() || id_ex_preg.read() ? cpi_alu :
+                                   id_ex_preg.get_bubble());
+        }
     }
-#ifdef DEBUG
-    if((inst = ex_mem_preg.read())) {
+    if(debug_t::enabled && (inst = ex_mem_preg.read())) {
         cout << ticks << " : execute : " << get_inst_str(inst, true) << endl;
     }
-#endif
 }
 
 // Instruction decode stage
-void proc_t::decode() {
+template <class fwd_t, class pred_t, class debug_t>
+void proc_t<fwd_t, pred_t, debug_t>::decode() {
     inst_t *inst = 0;
     // Decode stage makes a progress only if the ID/EX pipeline register is free.
     if(id_ex_preg.is_free()) {
         // Read an instruction from the IF/ID pipeline register.
         if((inst = if_id_preg.read())) {
+            // Record the first cycle that the instruction is decoded.
+            if(trace && (inst->seq != decode_seq)) {
+                trace->record(inst->seq, inst->pc, trace_decode);
+                decode_seq = inst->seq;
+            }
+            // Fuse the instruction with the next one if they form a known pair.
+            if(fusion && !inst->fused) { fuse(inst); }
             // Check the data dependency of instruction.
-            if(!reg_file->dep_check(inst)) {
+            context_t &context = contexts[inst->tid];
+            if(!context.reg_file->dep_check(inst)) {
                 // Remove the instruction from the IF/ID pipeline register.
                 if_id_preg.clear();
                 // Write the instruction in the ID/EX pipeline register.
                 id_ex_preg.write(inst);
                 // Update the PC for an unconditional jump.
-                if(inst->op == op_jalr) { pc = (inst->rs1_val + inst->imm) & -2; }
-                else if(inst->op == op_jal) { pc = inst->pc + (inst->imm<<1); }
+                // The target of a resolved jalr is known without its operand.
+                if(inst->op == op_jalr) {
+                    context.pc = inst->resolved ? inst->next_pc : (inst->rs1_val + inst->imm) & -2;
+                }
+                else if(inst->op == op_jal) { context.pc = inst->pc + (inst->imm<<1); }
             }
+            // A bubble is caused by a data hazard.
+            else { id_ex_preg.set_bubble(context.reg_file->is_load_use() ? cpi_load_use : cpi_data_hazard); }
         }
+        // A bubble comes from fetch.
+        else { id_ex_preg.set_bubble(if_id_preg.get_bubble()); }
     }
-#ifdef DEBUG
-    if((inst = id_ex_preg.read())) {
+    if(debug_t::enabled && (inst = id_ex_preg.read())) {
         cout << ticks << " : decode : " << get_inst_str(inst, true) << endl;
     }
-#endif
+}
+
+// Fuse an instruction with the next one. A pair is fused only if the next
+// instruction is the one to be fetched, and the second instruction reads
+// the rd of the first one. The second instruction is taken from the
+// instruction memory, and fetch skips it.
+template <class fwd_t, class pred_t, class debug_t>
+void proc_t<fwd_t, pred_t, debug_t>::fuse(inst_t *m_inst) {
+    context_t &context = contexts[m_inst->tid];
+    if((m_inst->rd_num <= 0) || (context.pc != m_inst->pc + 4)) { return; }
+    inst_t *next = context.inst_memory->read(context.pc);
+    if(!next) { return; }
+    next->tid = m_inst->tid;
+    if(get_fusion_type(m_inst, next) == num_fusion_types) { delete next; return; }
+    // The second instruction is on the correct path if the first one is.
+    if(m_inst->resolved) { exec_source->resolve(next); }
+
+    // Attach the second instruction, and let fetch skip it.
+    m_inst->fused = next;
+    context.pc += 4;
+    if(trace) { trace->record(m_inst->seq, next->pc, trace_fuse); }
+    if(get_op_type(next->op) == op_sb_type) { predict(next); }
+    if(debug_t::enabled) {
+        cout << ticks << " : decode : fused " << get_inst_str(m_inst, true)
+             << " + " << get_inst_str(next, true) << endl;
+    }
+}
+
+// Get the fusion pattern of an instruction pair.
+template <class fwd_t, class pred_t, class debug_t>
+fusion_type proc_t<fwd_t, pred_t, debug_t>::get_fusion_type(const inst_t *m_first, const inst_t *m_second) const {
+    bool reads_rd = (m_second->rs1_num == m_first->rd_num) ||
+                    (m_second->rs2_num == m_first->rd_num);
+    if((m_first->op == op_lui) && (m_second->op == op_addi) &&
+       (m_second->rs1_num == m_first->rd_num) && (m_second->rd_num == m_first->rd_num)) {
+        return fuse_lui_addi;
+    }
+    else if((m_first->op == op_slli) && (m_second->op == op_add) &&
+            reads_rd && (m_second->rd_num == m_first->rd_num)) {
+        return fuse_slli_add;
+    }
+    else if((m_first->op == op_addi) && (get_op_type(m_second->op) == op_sb_type) &&
+            (m_first->rs1_num == m_first->rd_num) && reads_rd) {
+        return fuse_addi_branch;
+    }
+    return num_fusion_types;
+}
+
+// Predict the next PC of a conditional branch.
+template <class fwd_t, class pred_t, class debug_t>
+void proc_t<fwd_t, pred_t, debug_t>::predict(inst_t *m_inst) {
+    uint64_t &pc = contexts[m_inst->tid].pc;
+    if(pred_t::enabled) {
+        // Set the PC to a branch target if the branch is predicted to be taken.
+        m_inst->pred_taken = br_predictor->is_taken(m_inst);
+        pc = m_inst->pred_target = m_inst->pred_taken ?
+                                   br_target_buffer->get_target(m_inst->pc) : pc;
+        // The functional model knows the outcome of a correct-path branch, and
+        // instructions fetched after a misprediction are on the wrong path.
+        if(m_inst->resolved && (pc != m_inst->branch_target)) { wrong_path = true; }
+    }
+    else {
+        // No branch prediction is used.
+        // Instruction fetch of the thread is disabled until the next PC is resolved.
+        pc = 0;
+        branch_pc = m_inst->pc;
+    }
 }
 
 // Instruction fetch stage
-void proc_t::fetch() {
+template <class fwd_t, class pred_t, class debug_t>
+void proc_t<fwd_t, pred_t, debug_t>::fetch() {
     inst_t *inst = 0;
     // Fetch stage makes a progress only if the IF/ID pipeline register is free.
     if(if_id_preg.is_free()) {
+        // Select a thread by the fetch policy if there are multiple threads.
+        unsigned tid = contexts.size() > 1 ? select_thread() : 0;
+        context_t &context = contexts[tid];
         // Read an instruction from the instruction memory.
-        if((inst = inst_memory->read(pc))) {
+        if((inst = context.inst_memory->read(context.pc))) {
+            inst->seq = next_seq++;
+            inst->tid = tid;
+            context.num_inflight++;
+            if(trace) { trace->record(inst->seq, inst->pc, trace_fetch); }
+            // A correct-path instruction takes its results from the functional model or a trace.
+            if(exec_source && !wrong_path) { exec_source->resolve(inst); }
             // Update the PC.
-            pc += 4;
+            context.pc += 4;
             // Write an instruction in the IF/ID pipeline register.
             if_id_preg.write(inst);
             // Make a branch prediction for a conditional branch.
-            if(get_op_type(inst->op) == op_sb_type) {
-#ifdef BR_PRED
-                // Set the PC to a branch target if the branch is predicted to be taken.
-                inst->pred_taken = br_predictor->is_taken(inst);
-                pc = inst->pred_target = inst->pred_taken ?
-                                         br_target_buffer->get_target(inst->pc) : pc;
-#else
-                // No branch prediction is used.
-                // Instruction fetch is disabled until the next PC is resolved.
-                pc = 0;
-#endif
-            }
+            if(get_op_type(inst->op) == op_sb_type) { predict(inst); }
+        }
+        else {
+            // A bubble is caused by an unresolved branch, or there is nothing to fetch.
+            bool branch_wait = false;
+            for(size_t i = 0; i < contexts.size(); i++) { branch_wait = branch_wait || !contexts[i].pc; }
+            if_id_preg.set_bubble(branch_wait ? cpi_branch : cpi_frontend);
+            // Fetch waits for an unresolved branch.
+            if(profile && !context.pc) { profile->get(branch_pc).branch_cycles++; }
         }
     }
     else {
         // Preceding instruction is blocking. Pipeline stalls.
         stalls++;
+        if(profile) { profile->get(if_id_preg.read()->pc).stall_cycles++; }
     }
-#ifdef DEBUG
-    if((inst = if_id_preg.read())) {
+    if(debug_t::enabled && (inst = if_id_preg.read())) {
         cout << ticks << " : fetch : " << get_inst_str(inst, true) << endl;
     }
-#endif
 }
 
-// Flush the pipeline. The pipeline uses a simplest stall-and-drain approach to
-// correct mis-speculative executions.
-void proc_t::flush() {
+// Does a thread have an instruction to fetch?
+template <class fwd_t, class pred_t, class debug_t>
+bool proc_t<fwd_t, pred_t, debug_t>::can_fetch(unsigned m_tid) const {
+    const context_t &context = contexts[m_tid];
+    return context.pc && context.inst_memory->peek(context.pc);
+}
+
+// Select a thread to fetch from. Threads are visited in round-robin order
+// from the one after the last fetched thread. Round-robin takes the first
+// thread that can fetch, and ICOUNT takes the one with the fewest instructions
+// in the pipeline. Switch-on-miss starts from the last fetched thread, and
+// passes over a thread waiting for a data cache miss unless no other thread
+// can fetch.
+template <class fwd_t, class pred_t, class debug_t>
+unsigned proc_t<fwd_t, pred_t, debug_t>::select_thread() {
+    unsigned num_threads = contexts.size(), tid = num_threads;
+    unsigned miss_tid = mem_inst && !data_cache->is_free() &&
+                        !(store_buffer && store_buffer->is_draining()) ? mem_inst->tid : num_threads;
+    unsigned first = policy == fetch_switch_on_miss ? 0 : 1;
+    for(unsigned i = first; i < first + num_threads; i++) {
+        unsigned t = (fetch_tid + i) % num_threads;
+        if(!can_fetch(t)) { continue; }
+        if(policy == fetch_icount) {
+            if((tid == num_threads) || (contexts[t].num_inflight < contexts[tid].num_inflight)) { tid = t; }
+        }
+        else if((policy == fetch_round_robin) || (t != miss_tid)) { tid = t; break; }
+        else if(tid == num_threads) { tid = t; }
+    }
+    // No thread can fetch.
+    if(tid == num_threads) { return fetch_tid; }
+    return fetch_tid = tid;
+}
+
+// Flush the instructions of a thread from the pipeline. The pipeline uses a
+// simplest stall-and-drain approach to correct mis-speculative executions.
+template <class fwd_t, class pred_t, class debug_t>
+void proc_t<fwd_t, pred_t, debug_t>::flush(unsigned m_tid, cpi_bucket m_cause) {
     inst_t *inst = 0;
-    // Clear all pipeline registers.
-    if((inst = if_id_preg.read()))  { delete inst; if_id_preg.clear();  }
-    if((inst = id_ex_preg.read()))  { delete inst; id_ex_preg.clear();  }
-    if((inst = ex_mem_preg.read())) { delete inst; ex_mem_preg.clear(); }
-    if((inst = mem_wb_preg.read())) { delete inst; mem_wb_preg.clear(); }
+    // Clear the pipeline registers holding instructions of the thread.
+    if((inst = if_id_preg.read())  && (inst->tid == m_tid)) { squash(inst); if_id_preg.clear();  }
+    if((inst = id_ex_preg.read())  && (inst->tid == m_tid)) { squash(inst); id_ex_preg.clear();  }
+    if((inst = ex_mem_preg.read()) && (inst->tid == m_tid)) { squash(inst); ex_mem_preg.clear(); }
+    if((inst = mem_wb_preg.read()) && (inst->tid == m_tid)) { squash(inst); mem_wb_preg.clear(); }
     // Flush ALU.
-    if((inst = alu->flush())) { delete inst; }
+    while((inst = alu->flush(m_tid))) { squash(inst); }
+    // The pipeline refills with bubbles caused by the flush.
+    if(if_id_preg.is_free())  { if_id_preg.set_bubble(m_cause);  }
+    if(id_ex_preg.is_free())  { id_ex_preg.set_bubble(m_cause);  }
+    if(ex_mem_preg.is_free()) { ex_mem_preg.set_bubble(m_cause); }
+    if(mem_wb_preg.is_free()) { mem_wb_preg.set_bubble(m_cause); }
     // Flush the dependency check state of register file.
-    reg_file->flush();
-    num_flushes++;
+    contexts[m_tid].reg_file->flush();
+    // Fetch restarts on the correct path.
+    wrong_path = false;
+}
+
+// Remove a squashed instruction.
+template <class fwd_t, class pred_t, class debug_t>
+void proc_t<fwd_t, pred_t, debug_t>::squash(inst_t *m_inst) {
+    contexts[m_inst->tid].num_inflight--;
+    if(trace) { trace->record(m_inst->seq, m_inst->pc, trace_flush); }
+    delete m_inst;
 }
 
 // Print pipeline stats.
-void proc_t::print_stats() {
+template <class fwd_t, class pred_t, class debug_t>
+void proc_t<fwd_t, pred_t, debug_t>::print_stats() {
     cout << endl << "======== [Kite Pipeline Stats] ========="      << endl;
     cout << "Total number of clock cycles = "          << ticks     << endl;
     cout << "Total number of stalled cycles = "        << stalls    << endl;
@@ -258,24 +722,215 @@ void proc_t::print_stats() {
     cout.precision(3);
     cout << "Cycles per instruction = "       << fixed
          << double(ticks) / double(num_insts) << endl;
-#ifdef BR_PRED
-    cout << "Number of pipeline flushes = "             << num_flushes            << endl;
-    cout << "Number of branch mispredictions = "        << num_br_mispredicts     << endl;
-    cout << "Number of branch target mispredictions = " << num_br_tgt_mispredicts << endl;
-    cout << "Branch prediction accuracy = "             << fixed
-         << (num_br_predicts ?
-               double(num_br_predicts-num_br_mispredicts-num_br_tgt_mispredicts)
-             / double(num_br_predicts) : 0)
-         << " (" <<   num_br_predicts-num_br_mispredicts-num_br_tgt_mispredicts
-         << "/"  <<   num_br_predicts << ")" << endl;
-#endif
+    if(pred_t::enabled) {
+        cout << "Number of pipeline flushes = "             << num_flushes            << endl;
+        cout << "Number of branch mispredictions = "        << num_br_mispredicts     << endl;
+        cout << "Number of branch target mispredictions = " << num_br_tgt_mispredicts << endl;
+        cout << "Branch prediction accuracy = "             << fixed
+             << (num_br_predicts ?
+                   double(num_br_predicts-num_br_mispredicts-num_br_tgt_mispredicts)
+                 / double(num_br_predicts) : 0)
+             << " (" <<   num_br_predicts-num_br_mispredicts-num_br_tgt_mispredicts
+             << "/"  <<   num_br_predicts << ")" << endl;
+    }
+    if(fusion) {
+        uint64_t num_pairs = num_fused[fuse_lui_addi] + num_fused[fuse_slli_add]
+                           + num_fused[fuse_addi_branch];
+        cout << "Number of fused instruction pairs = " << num_pairs
+             << " (lui+addi = "    << num_fused[fuse_lui_addi]
+             << ", slli+add = "    << num_fused[fuse_slli_add]
+             << ", addi+branch = " << num_fused[fuse_addi_branch] << ")" << endl;
+        cout << "Fusion rate = " << fixed
+             << (num_insts ? double(num_pairs<<1) / double(num_insts) : 0)
+             << " (" << (num_pairs<<1) << "/" << num_insts << " instructions)" << endl;
+    }
+    // Print the CPI stack.
+    static const char *cpi_names[] = { "Base", "Data hazard", "Load-use", "Multi-cycle ALU",
+                                       "Data cache", "Branch", "Front-end empty",
+                                       "Value mispredict", "Memory order" };
+    cout << "CPI stack:" << endl;
+    for(unsigned i = 0; i < num_cpi_buckets; i++) {
+        if((i == cpi_value) && !value_predictor) { continue; }
+        if((i == cpi_mem_order) && !store_buffer) { continue; }
+        cout << "    " << left << setw(16) << cpi_names[i] << right << " = " << fixed
+             << (num_insts ? double(cpi_cycles[i]) / double(num_insts) : 0)
+             << " (" << cpi_cycles[i] << " cycles)" << endl;
+    }
+    // Print the per-thread and combined IPC of multiple threads.
+    if(contexts.size() > 1) {
+        cout << "Hardware threads:" << endl;
+        for(size_t i = 0; i < contexts.size(); i++) {
+            cout << "    Thread " << i << " IPC = " << fixed
+                 << (ticks ? double(contexts[i].num_insts) / double(ticks) : 0)
+                 << " (" << contexts[i].num_insts << " instructions)" << endl;
+        }
+        cout << "    Combined IPC = " << fixed
+             << (ticks ? double(num_insts) / double(ticks) : 0) << endl;
+    }
     cout.precision(-1);
-    // Print data cache stats.
+    // Print the parameters that differ from the defaults.
+    config->print_changes();
+    // Print functional unit stats if the ALU has multiple units.
+    if(alu->num_units() > 1) { alu->print_stats(); }
+    // Print load value prediction stats.
+    if(value_predictor) { value_predictor->print_stats(); }
+    // Print data cache and store buffer stats.
     data_cache->print_stats();
-    // Print register file state.
-    reg_file->print_state();
-    // Print data memory state.
-    data_memory->print_state();
+    if(store_buffer) { store_buffer->print_stats(); }
+    // Print memory controller and DRAM stats.
+    data_memory->print_stats();
+    if(dram) { dram->print_stats(); }
+    // Print MMU stats.
+    if(mmu) { mmu->print_stats(); }
+    // Print stack distance analysis.
+    if(stack_dist) { stack_dist->print_stats(); }
+    // Print the per-PC profile.
+    if(profile) { profile->print_stats(data_cache); }
+    // Print register file and data memory states.
+    if(replay) { cout << endl << "Register and memory states are not available in trace replay." << endl; }
+    else if(contexts.size() == 1) {
+        contexts[0].reg_file->print_state();
+        data_memory->print_state();
+    }
+    else {
+        for(size_t i = 0; i < contexts.size(); i++) {
+            cout << endl << "Thread " << i << ":";
+            contexts[i].reg_file->print_state();
+            data_memory->print_state(contexts[i].mem_base, uint64_t(1) << smt_mem_shift);
+        }
+    }
+    // Print host stats.
+    if(host_stats) { print_host_stats(); }
     cout << endl << "======== [End of Pipeline Stats] =========" << endl;
 }
 
+// Print host throughput and memory usage.
+template <class fwd_t, class pred_t, class debug_t>
+void proc_t<fwd_t, pred_t, debug_t>::print_host_stats() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+    double peak_rss = double(usage.ru_maxrss) / (1 << 20);     // Bytes on macOS
+#else
+    double peak_rss = double(usage.ru_maxrss) / (1 << 10);     // Kilobytes on Linux
+#endif
+    cout << endl << "Host stats:" << endl;
+    cout.precision(3);
+    cout << "    Simulation time = " << fixed << host_seconds << " seconds" << endl;
+    cout << "    Simulation speed = " << fixed
+         << (host_seconds ? double(num_insts) / host_seconds / 1e3 : 0) << " KIPS" << endl;
+    cout << "    Simulated cycles per second = " << fixed << setprecision(0)
+         << (host_seconds ? double(ticks) / host_seconds : 0) << setprecision(3) << endl;
+    cout << "    Peak resident set size = " << fixed << peak_rss << " MB" << endl;
+    cout.precision(-1);
+}
+
+// Register stats of the processor and its components.
+template <class fwd_t, class pred_t, class debug_t>
+void proc_t<fwd_t, pred_t, debug_t>::register_stats() {
+    stats.add_counter("proc.cycles", &ticks, "Total number of clock cycles");
+    stats.add_counter("proc.stalls", &stalls, "Total number of stalled cycles");
+    stats.add_counter("proc.insts", &num_insts, "Total number of executed instructions");
+    stats.add_counter("proc.flushes", &num_flushes, "Number of pipeline flushes");
+    stats.add_formula("proc.cpi", "proc.cycles", "proc.insts", "Cycles per instruction");
+    for(size_t i = 0; contexts.size() > 1 && i < contexts.size(); i++) {
+        string prefix = "thread" + to_string(i);
+        stats.add_counter(prefix + ".insts", &contexts[i].num_insts,
+                          "Number of executed instructions of thread " + to_string(i));
+        stats.add_formula(prefix + ".ipc", prefix + ".insts", "proc.cycles",
+                          "Instructions per cycle of thread " + to_string(i));
+    }
+    stats.add_counter("cpi_stack.base", &cpi_cycles[cpi_base], "Cycles retiring instructions");
+    stats.add_counter("cpi_stack.data_hazard", &cpi_cycles[cpi_data_hazard],
+                      "Cycles lost to data hazards on non-load producers");
+    stats.add_counter("cpi_stack.load_use", &cpi_cycles[cpi_load_use],
+                      "Cycles lost to load-use hazards");
+    stats.add_counter("cpi_stack.alu", &cpi_cycles[cpi_alu],
+                      "Cycles lost to multi-cycle ALU operations");
+    stats.add_counter("cpi_stack.dcache", &cpi_cycles[cpi_dcache],
+                      "Cycles lost to the data cache and MMU");
+    stats.add_counter("cpi_stack.branch", &cpi_cycles[cpi_branch],
+                      "Cycles lost to branch flushes and unresolved branches");
+    stats.add_counter("cpi_stack.frontend", &cpi_cycles[cpi_frontend],
+                      "Cycles with an empty front-end");
+    if(value_predictor) {
+        stats.add_counter("cpi_stack.value", &cpi_cycles[cpi_value],
+                          "Cycles lost to load value mispredictions");
+        value_predictor->register_stats(&stats, "vp");
+    }
+    if(pred_t::enabled) {
+        stats.add_counter("branch.predicts", &num_br_predicts, "Number of branch predictions");
+        stats.add_counter("branch.mispredicts", &num_br_mispredicts,
+                          "Number of branch mispredictions");
+        stats.add_counter("branch.target_mispredicts", &num_br_tgt_mispredicts,
+                          "Number of branch target mispredictions");
+        stats.add_formula("branch.accuracy",
+                          "branch.predicts - branch.mispredicts - branch.target_mispredicts",
+                          "branch.predicts", "Branch prediction accuracy");
+    }
+    if(fusion) {
+        stats.add_counter("fusion.lui_addi", &num_fused[fuse_lui_addi],
+                          "Number of fused lui+addi pairs");
+        stats.add_counter("fusion.slli_add", &num_fused[fuse_slli_add],
+                          "Number of fused slli+add pairs");
+        stats.add_counter("fusion.addi_branch", &num_fused[fuse_addi_branch],
+                          "Number of fused addi+branch pairs");
+        stats.add_formula("fusion.rate",
+                          "2*fusion.lui_addi + 2*fusion.slli_add + 2*fusion.addi_branch",
+                          "proc.insts", "Fraction of instructions in fused pairs");
+    }
+    if(alu->num_units() > 1) {
+        alu->register_stats(&stats, "fu");
+        static const char *fu_prefixes[] = { "alu", "mul", "div" };
+        uint64_t num_units[num_fu_types] = { config->fu_alus, config->fu_muls, config->fu_divs };
+        for(unsigned i = 0; i < num_fu_types; i++) {
+            if(!num_units[i]) { continue; }
+            string prefix = string("fu.") + fu_prefixes[i];
+            stats.add_formula(prefix + ".utilization", prefix + ".busy",
+                              to_string(num_units[i]) + "*proc.cycles",
+                              "Fraction of unit cycles that units are busy");
+        }
+    }
+    data_cache->register_stats(&stats, "dcache");
+    if(store_buffer) {
+        stats.add_counter("cpi_stack.mem_order", &cpi_cycles[cpi_mem_order],
+                          "Cycles lost to loads that ran ahead of buffered stores");
+        store_buffer->register_stats(&stats, "sb");
+    }
+    data_memory->register_stats(&stats, "memory");
+    stats.add_formula("memory.bandwidth", "memory.bytes", "proc.cycles", "Bytes per cycle");
+    stats.add_formula("memory.utilization", "memory.bus_busy", "proc.cycles",
+                      "Fraction of cycles of data transfer");
+    if(dram) { dram->register_stats(&stats, "dram"); }
+    if(mmu) { mmu->register_stats(&stats, "mmu"); }
+    if(stack_dist) { stack_dist->register_stats(&stats, "stack_dist"); }
+    config->register_stats(&stats, "config");
+}
+
+// All combinations of pipeline policies are built into the simulator.
+template class proc_t<fwd_off_t, pred_off_t, debug_off_t>;
+template class proc_t<fwd_off_t, pred_off_t, debug_on_t>;
+template class proc_t<fwd_off_t, pred_on_t,  debug_off_t>;
+template class proc_t<fwd_off_t, pred_on_t,  debug_on_t>;
+template class proc_t<fwd_on_t,  pred_off_t, debug_off_t>;
+template class proc_t<fwd_on_t,  pred_off_t, debug_on_t>;
+template class proc_t<fwd_on_t,  pred_on_t,  debug_off_t>;
+template class proc_t<fwd_on_t,  pred_on_t,  debug_on_t>;
+
+// Create a processor with the pipeline policies selected by a configuration.
+proc_base_t* new_proc(const config_t *m_config) {
+    if(m_config->data_fwd) {
+        if(m_config->br_pred) {
+            if(m_config->debug) { return new proc_t<fwd_on_t, pred_on_t, debug_on_t>(); }
+            return new proc_t<fwd_on_t, pred_on_t, debug_off_t>();
+        }
+        if(m_config->debug) { return new proc_t<fwd_on_t, pred_off_t, debug_on_t>(); }
+        return new proc_t<fwd_on_t, pred_off_t, debug_off_t>();
+    }
+    if(m_config->br_pred) {
+        if(m_config->debug) { return new proc_t<fwd_off_t, pred_on_t, debug_on_t>(); }
+        return new proc_t<fwd_off_t, pred_on_t, debug_off_t>();
+    }
+    if(m_config->debug) { return new proc_t<fwd_off_t, pred_off_t, debug_on_t>(); }
+    return new proc_t<fwd_off_t, pred_off_t, debug_off_t>();
+}
@@ -2,49 +2,166 @@
 #define __KITE_PROC_H__
 
 #include <cstdint>
+#include <string>
+#include <vector>
 #include "alu.h"
 #include "br_predictor.h"
+#include "config.h"
 #include "data_cache.h"
 #include "data_memory.h"
+#include "dram.h"
+#include "exec_trace.h"
+#include "func_sim.h"
 #include "inst_memory.h"
+#include "mmu.h"
 #include "pipe_reg.h"
+#include "profile.h"
 #include "reg_file.h"
+#include "stack_dist.h"
+#include "stats.h"
+#include "store_buffer.h"
+#include "trace.h"
+#include "value_predictor.h"
 
-class proc_t {
+// Macro-op fusion patterns of adjacent instruction pairs
+enum fusion_type {
+    fuse_lui_addi = 0,                      // lui rd, imm; addi rd, rd, imm
+    fuse_slli_add,                          // slli rd, rs1, imm; add rd, rd, rs2
+    fuse_addi_branch,                       // addi rd, rd, imm; bne/beq/blt/bge rd, rs2, label
+    num_fusion_types,
+};
+
+// Fetch policies of multiple hardware threads
+enum fetch_policy {
+    fetch_round_robin = 0,                  // Take turns among threads that can fetch.
+    fetch_icount,                           // Favor the thread with the fewest instructions in the pipeline.
+    fetch_switch_on_miss,                   // Stay on a thread until it waits for a data cache miss.
+};
+
+// The data memory space of thread t starts at t << smt_mem_shift.
+#define smt_mem_shift       40
+
+// Hardware thread context. Threads share the pipeline, ALU, branch predictor,
+// and data cache, and each thread runs its own program with its own registers
+// and data memory space.
+struct context_t {
+    inst_memory_t *inst_memory;             // Instruction memory
+    reg_file_t *reg_file;                   // Register file
+    uint64_t pc;                            // Program counter
+    uint64_t mem_base;                      // Base address of the data memory space
+    uint64_t num_insts;                     // Number of executed instructions
+    uint64_t num_inflight;                  // Number of instructions in the pipeline
+};
+
+// Pipeline policies select data forwarding, branch prediction, and debug
+// messages at compile time. A disabled policy folds away from the pipeline.
+struct fwd_off_t   { static const bool enabled = false; };  // Wait for register writeback.
+struct fwd_on_t    { static const bool enabled = true;  };  // Forward results from EX and MEM.
+struct pred_off_t  { static const bool enabled = false; };  // Stall fetch on conditional branches.
+struct pred_on_t   { static const bool enabled = true;  };  // Predict branches, and flush on mispredictions.
+struct debug_off_t { static const bool enabled = false; };
+struct debug_on_t  { static const bool enabled = true;  };  // Print pipeline progress every cycle.
+
+// Processor interface
+class proc_base_t {
+public:
+    virtual ~proc_base_t() {}
+
+    // Processor initialization with a program per hardware thread
+    virtual void init(const std::vector<std::string> &m_programs, const config_t *m_config) = 0;
+    // Write a stats summary file, and dump stats every m_interval cycles or instructions.
+    virtual void set_stats_output(const char *m_summary, const char *m_dump = 0,
+                                  uint64_t m_interval = 0, bool m_inst_interval = false) = 0;
+    // Trace pipeline events within the [m_start, m_end) cycle window.
+    virtual void set_trace(const char *m_file, uint64_t m_start = 0, uint64_t m_end = 0) = 0;
+    virtual void set_profile(const char *m_file) = 0;   // Profile the program per PC, and write a listing.
+    virtual void set_host_stats(bool m_host_stats) = 0; // Print host throughput and memory usage.
+    virtual void run() = 0;                             // Run the processor pipeline.
+};
+
+// Create a processor with the pipeline policies selected by a configuration.
+proc_base_t* new_proc(const config_t *m_config);
+
+// Five-stage pipeline with data forwarding, branch prediction, and debug policies
+template <class fwd_t, class pred_t, class debug_t>
+class proc_t : public proc_base_t {
 public:
     proc_t();
     ~proc_t();
 
-    void init(const char *m_program_code);  // Processor initialization
+    // Processor initialization with a program per hardware thread
+    void init(const std::vector<std::string> &m_programs, const config_t *m_config);
+    // Write a stats summary file, and dump stats every m_interval cycles or instructions.
+    void set_stats_output(const char *m_summary, const char *m_dump = 0,
+                          uint64_t m_interval = 0, bool m_inst_interval = false);
+    // Trace pipeline events within the [m_start, m_end) cycle window.
+    void set_trace(const char *m_file, uint64_t m_start = 0, uint64_t m_end = 0);
+    void set_profile(const char *m_file);   // Profile the program per PC, and write a listing.
+    void set_host_stats(bool m_host_stats); // Print host throughput and memory usage.
     void run();                             // Run the processor pipeline.
 
 private:
     void writeback();                       // Writeback stage
     void memory();                          // Memory stage
+    bool access_cache(inst_t *m_inst);      // Access the data cache for a load or store.
     void execute();                         // Execute stage
     void decode();                          // Instruction decode stage
+    void fuse(inst_t *m_inst);              // Fuse an instruction with the next one.
+    // Get the fusion pattern of an instruction pair.
+    fusion_type get_fusion_type(const inst_t *m_first, const inst_t *m_second) const;
+    void predict(inst_t *m_inst);           // Predict the next PC of a conditional branch.
     void fetch();                           // Instruction fetch stage
-    void flush();                           // Flush pipeline.
+    bool can_fetch(unsigned m_tid) const;   // Does a thread have an instruction to fetch?
+    unsigned select_thread();               // Select a thread to fetch from.
+    // Flush the instructions of a thread from the pipeline.
+    void flush(unsigned m_tid, cpi_bucket m_cause = cpi_branch);
+    void squash(inst_t *m_inst);            // Remove a squashed instruction.
     void print_stats();                     // Print pipeline stats.
+    void print_host_stats();                // Print host throughput and memory usage.
+    void register_stats();                  // Register stats of the processor and its components.
 
     uint64_t stalls;                        // Number of stall cycles
     uint64_t num_insts;                     // Number of instructions
-#ifdef BR_PRED
     uint64_t num_br_predicts;               // Number of branch predictions
     uint64_t num_br_mispredicts;            // Number of branch mis-predictions
     uint64_t num_br_tgt_mispredicts;        // Number of branch target mis-predictions
-#endif
     uint64_t num_flushes;                   // Number of pipeline flushes
+    uint64_t num_fused[num_fusion_types];   // Number of fused pairs per pattern
+    uint64_t cpi_cycles[num_cpi_buckets];   // Cycles per CPI stack bucket
+    bool fusion;                            // Is macro-op fusion enabled?
     uint64_t ticks;                         // Clock ticks (cycles)
-    uint64_t pc;                            // Program counter
+    uint64_t next_seq;                      // Sequence number of the next fetched instruction
+    uint64_t decode_seq;                    // Sequence number of the last decoded instruction
+    stats_t stats;                          // Statistics registry
+    const char *stats_summary;              // Stats summary file (optional)
+    const config_t *config;                 // Configuration
 
-    inst_memory_t *inst_memory;             // Instruction memory
+    std::vector<context_t> contexts;        // Hardware thread contexts
+    fetch_policy policy;                    // Fetch policy of multiple threads
+    unsigned fetch_tid;                     // Thread of the last fetch
     br_predictor_t *br_predictor;           // Branch predictor
     br_target_buffer_t *br_target_buffer;   // Branch target buffer
-    reg_file_t *reg_file;                   // Register file
     alu_t *alu;                             // ALU
+    value_predictor_t *value_predictor;     // Load value predictor (optional)
     data_memory_t *data_memory;             // Data memory
     data_cache_t *data_cache;               // Data cache
+    store_buffer_t *store_buffer;           // Store buffer (optional)
+    dram_t *dram;                           // DRAM backend (optional)
+    mmu_t *mmu;                             // MMU for virtual memory (optional)
+    stack_dist_t *stack_dist;               // Stack distance analyzer (optional)
+    func_sim_t *func_sim;                   // Functional model (optional)
+    exec_trace_reader_t *replay;            // Execution trace to replay (optional)
+    exec_source_t *exec_source;             // Source of resolved instructions (optional)
+    exec_trace_writer_t *capture;           // Execution trace to capture (optional)
+    bool wrong_path;                        // Is fetch on a mispredicted path?
+    trace_t *trace;                         // Pipeline trace (optional)
+    profile_t *profile;                     // Per-PC profile (optional)
+    const char *profile_file;               // Per-PC profile listing file
+    uint64_t branch_pc;                     // PC of the last branch that redirected fetch
+    uint64_t flush_ticks;                   // Ticks of the last pipeline flush
+    bool host_stats;                        // Print host stats?
+    double host_seconds;                    // Host time spent running the pipeline
+    inst_t *mem_inst;                       // Instruction in the memory stage
     pipe_reg_t if_id_preg, id_ex_preg;      // Pipeline registers
     pipe_reg_t ex_mem_preg, mem_wb_preg;
 };
@@ -0,0 +1,84 @@
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include "profile.h"
+
+using namespace std;
+
+profile_t::profile_t(inst_memory_t *m_inst_memory) :
+    inst_memory(m_inst_memory),
+    entries(m_inst_memory->num_insts(), profile_entry_t()) {
+}
+
+profile_t::~profile_t() {
+}
+
+// Get cycles lost by an instruction.
+uint64_t profile_t::get_lost_cycles(const profile_entry_t &m_entry) const {
+    return m_entry.stall_cycles + m_entry.alu_cycles + m_entry.mem_cycles + m_entry.branch_cycles;
+}
+
+// Order (cycles lost, PC) pairs by descending cycles lost, and then by PC.
+static bool more_lost(const pair<uint64_t, uint64_t> &m_a, const pair<uint64_t, uint64_t> &m_b) {
+    return (m_a.first > m_b.first) || ((m_a.first == m_b.first) && (m_a.second < m_b.second));
+}
+
+// Sort executed PCs by cycles lost.
+vector<uint64_t> profile_t::get_sorted_pcs() const {
+    vector<pair<uint64_t, uint64_t> > lost;
+    for(uint64_t i = 1; i < entries.size(); i++) {
+        if(entries[i].count || get_lost_cycles(entries[i])) {
+            lost.push_back(pair<uint64_t, uint64_t>(get_lost_cycles(entries[i]), i << 2));
+        }
+    }
+    sort(lost.begin(), lost.end(), more_lost);
+    vector<uint64_t> pcs;
+    for(size_t i = 0; i < lost.size(); i++) { pcs.push_back(lost[i].second); }
+    return pcs;
+}
+
+// Print the top instructions by cycles lost.
+void profile_t::print_stats(data_cache_t *m_data_cache) {
+    vector<uint64_t> pcs = get_sorted_pcs();
+    cout << endl << "Per-PC profile (top " << min(pcs.size(), size_t(10))
+         << " instructions by cycles lost):" << endl;
+    for(size_t i = 0; (i < pcs.size()) && (i < 10); i++) {
+        profile_entry_t &entry = entries[pcs[i] >> 2];
+        inst_t *inst = inst_memory->read(pcs[i]);
+        cout << "    [pc=" << pcs[i] << "] " << get_inst_str(inst) << " = "
+             << get_lost_cycles(entry) << " cycles (count " << entry.count
+             << ", stall " << entry.stall_cycles << ", alu " << entry.alu_cycles
+             << ", memory " << entry.mem_cycles << ", branch " << entry.branch_cycles
+             << ", misses " << m_data_cache->get_pc_misses(pcs[i])
+             << ", mispredicts " << entry.mispredicts << ")" << endl;
+        delete inst;
+    }
+}
+
+// Write an annotated listing of the program sorted by cycles lost.
+void profile_t::write_listing(const char *m_file, data_cache_t *m_data_cache) {
+    ofstream out(m_file);
+    if(!out.is_open()) {
+        cerr << "Error: failed to open " << m_file << endl;
+        exit(1);
+    }
+    out << "# Per-PC profile sorted by cycles lost" << endl;
+    out << "# lost = stall + alu + memory + branch cycles" << endl;
+    out << "#" << setw(9) << "pc" << setw(12) << "count" << setw(12) << "lost"
+        << setw(12) << "stall" << setw(12) << "alu" << setw(12) << "memory"
+        << setw(12) << "branch" << setw(10) << "misses" << setw(10) << "mispred"
+        << "  instruction" << endl;
+    vector<uint64_t> pcs = get_sorted_pcs();
+    for(size_t i = 0; i < pcs.size(); i++) {
+        profile_entry_t &entry = entries[pcs[i] >> 2];
+        inst_t *inst = inst_memory->read(pcs[i]);
+        out << setw(10) << pcs[i] << setw(12) << entry.count << setw(12) << get_lost_cycles(entry)
+            << setw(12) << entry.stall_cycles << setw(12) << entry.alu_cycles
+            << setw(12) << entry.mem_cycles << setw(12) << entry.branch_cycles
+            << setw(10) << m_data_cache->get_pc_misses(pcs[i]) << setw(10) << entry.mispredicts
+            << "  " << get_inst_str(inst) << endl;
+        delete inst;
+    }
+}
+
@@ -0,0 +1,41 @@
+#ifndef __KITE_PROFILE_H__
+#define __KITE_PROFILE_H__
+
+#include <cstdint>
+#include <vector>
+#include "data_cache.h"
+#include "inst_memory.h"
+
+// Per-PC profile of a static instruction
+struct profile_entry_t {
+    uint64_t count;                         // Number of executions
+    uint64_t stall_cycles;                  // Cycles stalled in the IF/ID pipeline register
+    uint64_t alu_cycles;                    // ALU latency cycles beyond the first cycle
+    uint64_t mem_cycles;                    // Memory stage cycles waiting for the cache or MMU
+    uint64_t mispredicts;                   // Number of branch mispredictions
+    uint64_t branch_cycles;                 // Cycles lost to branch resolution and flushes
+};
+
+// Per-PC performance profile of the simulated program. The cycles lost by an
+// instruction are the sum of its stall, ALU, memory, and branch cycles.
+class profile_t {
+public:
+    profile_t(inst_memory_t *m_inst_memory);
+    ~profile_t();
+
+    // Get the profile entry of an instruction.
+    profile_entry_t& get(uint64_t m_pc) { return entries[(m_pc >> 2) < entries.size() ? m_pc >> 2 : 0]; }
+    void print_stats(data_cache_t *m_data_cache);           // Print the top instructions by cycles lost.
+    // Write an annotated listing of the program sorted by cycles lost.
+    void write_listing(const char *m_file, data_cache_t *m_data_cache);
+
+private:
+    uint64_t get_lost_cycles(const profile_entry_t &m_entry) const;    // Get cycles lost.
+    std::vector<uint64_t> get_sorted_pcs() const;           // Sort executed PCs by cycles lost.
+
+    inst_memory_t *inst_memory;             // Instruction memory
+    std::vector<profile_entry_t> entries;   // Profile entries indexed by PC/4
+};
+
+#endif
+
@@ -6,18 +6,24 @@
 
 using namespace std;
 
-reg_file_t::reg_file_t() {
+reg_file_t::reg_file_t(const char *m_reg_state) :
+    load_use(false) {
     // Clear all values in the registers and dependency check table.
     memset(regs, 0, sizeof(regs));
     memset(dep, 0, sizeof(dep));
 
     // Load initial register file state.
-    load_reg_state();
+    if(m_reg_state) { load_reg_state(m_reg_state); }
 }
 
 reg_file_t::~reg_file_t() {
 }
 
+// Read a register without dependency check.
+int64_t reg_file_t::read(unsigned m_regnum) const {
+    return regs[m_regnum];
+}
+
 // Write in the register file. 
 void reg_file_t::write(inst_t *m_inst, unsigned m_regnum, int64_t m_value) {
     regs[m_regnum] = m_value;
@@ -28,49 +34,66 @@ void reg_file_t::write(inst_t *m_inst, unsigned m_regnum, int64_t m_value) {
 
 // Data dependency check
 bool reg_file_t::dep_check(inst_t *m_inst) {
-    bool stall = false;
-    inst_t *prod_inst = 0;
-    if(m_inst->rs1_num > 0) {
-        // Check the data hazard for rs1.
-        if((prod_inst = dep[m_inst->rs1_num])) {
-            // Rs1 value is forwarded from a producer instruction.
-            if(prod_inst->rd_ready) { m_inst->rs1_val = prod_inst->rd_val; }
-            // Rs1 is not ready yet.
-            else { stall = true; }
+    load_use = false;
+    bool stall = read_operand(m_inst->rs1_num, m_inst->rs1_val);
+    stall = read_operand(m_inst->rs2_num, m_inst->rs2_val) || stall;
+    // The second instruction of a fused pair receives the rd value of the
+    // first one inside the pair, and other operands are checked as usual.
+    inst_t *fused = m_inst->fused;
+    if(fused) {
+        if(fused->rs1_num != m_inst->rd_num) {
+            stall = read_operand(fused->rs1_num, fused->rs1_val) || stall;
         }
-        // Rs1 is clear to go.
-        else { m_inst->rs1_val = regs[m_inst->rs1_num]; }
-    }
-    if(m_inst->rs2_num > 0) {
-        // Check the data hazard for rs2.
-        if((prod_inst = dep[m_inst->rs2_num])) {
-            // Rs2 value is forwarded from a producer instruction.
-            if(prod_inst->rd_ready) { m_inst->rs2_val = prod_inst->rd_val; }
-            // Rs2 is not ready yet.
-            else { stall = true; }
+        if(fused->rs2_num != m_inst->rd_num) {
+            stall = read_operand(fused->rs2_num, fused->rs2_val) || stall;
         }
-        // Rs2 is clear to go.
-        else { m_inst->rs2_val = regs[m_inst->rs2_num]; }
     }
-    if(!stall && (m_inst->rd_num > 0)) {
+    if(!stall) {
         // This instruction is the last producer of rd.
-        dep[m_inst->rd_num] = m_inst;
+        if(m_inst->rd_num > 0) { dep[m_inst->rd_num] = m_inst; }
+        if(fused && (fused->rd_num > 0)) { dep[fused->rd_num] = fused; }
     }
     return stall;
 }
 
+// Did the last dependency check wait for a load?
+bool reg_file_t::is_load_use() const {
+    return load_use;
+}
+
+// Read a source operand, and return true if it is not ready.
+bool reg_file_t::read_operand(int m_regnum, int64_t &m_value) {
+    if(m_regnum <= 0) { return false; }
+    // Check the data hazard for the register.
+    inst_t *prod_inst = dep[m_regnum];
+    if(prod_inst) {
+        // Value is forwarded from a producer instruction.
+        if(prod_inst->rd_ready) { m_value = prod_inst->rd_val; }
+        // Value is not ready yet.
+        else { load_use = load_use || (prod_inst->op == op_ld); return true; }
+    }
+    // Register is clear to go.
+    else { m_value = regs[m_regnum]; }
+    return false;
+}
+
 // Clear the dependency check state.
 void reg_file_t::flush() {
     memset(dep, 0, sizeof(dep));
 }
 
+// Make an instruction the last producer of its rd.
+void reg_file_t::claim(inst_t *m_inst) {
+    if(m_inst->rd_num > 0) { dep[m_inst->rd_num] = m_inst; }
+}
+
 // Load initial register file state.
-void reg_file_t::load_reg_state() {
+void reg_file_t::load_reg_state(const char *m_file) {
     // Open a register state file.
     fstream file_stream;
-    file_stream.open("reg_state", fstream::in);
+    file_stream.open(m_file, fstream::in);
     if(!file_stream.is_open()) {
-        cerr << "Error: failed to open reg_state" << endl;
+        cerr << "Error: failed to open " << m_file << endl;
         exit(1);
     }
 
@@ -98,12 +121,12 @@ void reg_file_t::load_reg_state() {
         size_t reg_num = get_regnum(reg_name);
         if(!is_reg_str(reg_name) || (reg_num >= num_kite_regs)) {
             cerr << "Error: invalid register name " << reg_name
-                 << " at line #" << line_num << " of reg_state" << endl;
+                 << " at line #" << line_num << " of " << m_file << endl;
             exit(1);
         }
         if(line.length() <= 0) {
             cerr << "Error: invalid register value for " << reg_name
-                 << " at line #" << line_num << " of reg_state" << endl;
+                 << " at line #" << line_num << " of " << m_file << endl;
             exit(1);
         }
         regs[reg_num] = get_imm(line);
@@ -111,7 +134,7 @@ void reg_file_t::load_reg_state() {
         // Mark that the register state has been loaded.
         if((loaded >> reg_num) & 0b1) {
             cerr << "Error: redefinition of register state for " << reg_name
-                 << " at line #" << line_num << " of reg_state" << endl;
+                 << " at line #" << line_num << " of " << m_file << endl;
             exit(1);
         }
         loaded |= (0b1 << reg_num);
@@ -7,18 +7,24 @@
 // Register file
 class reg_file_t {
 public:
-    reg_file_t();
+    reg_file_t(const char *m_reg_state = "reg_state");
     ~reg_file_t();
 
+    int64_t read(unsigned m_regnum) const;          // Read a register without dependency check.
     void write(inst_t *m_inst, unsigned m_regnum, int64_t m_value);  // Write register file.
     bool dep_check(inst_t *m_inst);                 // Data dependency check
+    bool is_load_use() const;                       // Did the last dependency check wait for a load?
     void flush();                                   // Clear the dependency check state.
-    void load_reg_state();                          // Load initial register file state.
+    void claim(inst_t *m_inst);                     // Make an instruction the last producer of its rd.
+    void load_reg_state(const char *m_file);        // Load initial register file state.
     void print_state() const;                       // Print register state.
 
 private:
+    bool read_operand(int m_regnum, int64_t &m_value); // Read an operand, or return true on a hazard.
+
     int64_t regs[num_kite_regs];                    // Array of registers
     inst_t *dep[num_kite_regs];                     // Dependency check table
+    bool load_use;                                  // Is an operand waiting for a load?
 };
 
 #endif
@@ -0,0 +1,72 @@
+#ifndef __KITE_SPSC_RING_H__
+#define __KITE_SPSC_RING_H__
+
+#include <atomic>
+#include <cstdint>
+
+// Lock-free ring buffer between a single producer thread and a single
+// consumer thread. Each side owns one index and reads the other side's index
+// only when its cached copy says that the ring looks full or empty.
+template <class T>
+class spsc_ring_t {
+public:
+    spsc_ring_t(uint64_t m_size);           // The size must be a power of two.
+    ~spsc_ring_t();
+
+    bool push(const T &m_item);             // Push an item, and return false if the ring is full.
+    bool pop(T &m_item);                    // Pop an item, and return false if the ring is empty.
+
+private:
+    T *items;                               // Ring entries
+    uint64_t mask;                          // Index mask
+
+    // The indices of the two sides are kept in separate cache lines.
+    alignas(64) std::atomic<uint64_t> head; // Next entry to pop (consumer)
+    uint64_t cached_tail;                   // Consumer's copy of the tail
+    alignas(64) std::atomic<uint64_t> tail; // Next entry to push (producer)
+    uint64_t cached_head;                   // Producer's copy of the head
+};
+
+template <class T>
+spsc_ring_t<T>::spsc_ring_t(uint64_t m_size) :
+    items(new T[m_size]),
+    mask(m_size - 1),
+    head(0),
+    cached_tail(0),
+    tail(0),
+    cached_head(0) {
+}
+
+template <class T>
+spsc_ring_t<T>::~spsc_ring_t() {
+    delete [] items;
+}
+
+// Push an item, and return false if the ring is full.
+template <class T>
+bool spsc_ring_t<T>::push(const T &m_item) {
+    uint64_t t = tail.load(std::memory_order_relaxed);
+    if(t - cached_head > mask) {
+        cached_head = head.load(std::memory_order_acquire);
+        if(t - cached_head > mask) { return false; }
+    }
+    items[t & mask] = m_item;
+    tail.store(t + 1, std::memory_order_release);
+    return true;
+}
+
+// Pop an item, and return false if the ring is empty.
+template <class T>
+bool spsc_ring_t<T>::pop(T &m_item) {
+    uint64_t h = head.load(std::memory_order_relaxed);
+    if(h == cached_tail) {
+        cached_tail = tail.load(std::memory_order_acquire);
+        if(h == cached_tail) { return false; }
+    }
+    m_item = items[h & mask];
+    head.store(h + 1, std::memory_order_release);
+    return true;
+}
+
+#endif
+
@@ -0,0 +1,194 @@
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include "stack_dist.h"
+#include "stats.h"
+
+using namespace std;
+
+// Convert a size in bytes to a string with a unit.
+static string get_size_str(uint64_t m_size) {
+    stringstream ss;
+    if(m_size >= (1 << 20) && !(m_size & ((1 << 20) - 1))) { ss << (m_size >> 20) << "MB"; }
+    else if(m_size >= (1 << 10) && !(m_size & ((1 << 10) - 1))) { ss << (m_size >> 10) << "KB"; }
+    else { ss << m_size << "B"; }
+    return ss.str();
+}
+
+stack_dist_t::stack_dist_t(uint64_t m_block_size, unsigned m_max_set_bits, unsigned m_max_ways) :
+    block_size(m_block_size),
+    block_offset(0),
+    max_set_bits(m_max_set_bits),
+    max_ways(m_max_ways),
+    stacks(0),
+    depths(0),
+    hits(0),
+    time(0),
+    reuse_hist(65, 0),
+    num_accesses(0),
+    num_cold(0) {
+    // Calculate the block offset.
+    uint64_t val = block_size;
+    while(val && !(val & 0b1)) { val = val >> 1; block_offset++; }
+    if(val != 1) {
+        cerr << "Error: block size of stack distance analysis must be a power of two" << endl;
+        exit(1);
+    }
+    // Check if the stack depth is a power of two.
+    if(!max_ways || (max_ways & (max_ways - 1))) {
+        cerr << "Error: number of ways of stack distance analysis must be a power of two" << endl;
+        exit(1);
+    }
+
+    // Allocate per-set LRU stacks for all set counts.
+    uint64_t total_sets = (uint64_t(2) << max_set_bits) - 1;
+    stacks = new uint64_t[total_sets * max_ways]();
+    depths = new unsigned[total_sets]();
+    hits   = new uint64_t[(max_set_bits + 1) * max_ways]();
+
+    // Allocate the Fenwick tree of reuse timestamps.
+    tree.resize((1 << 16) + 1, 0);
+    time_block.resize(1 << 16, 0);
+}
+
+stack_dist_t::~stack_dist_t() {
+    // Deallocate the LRU stacks.
+    delete [] stacks;
+    delete [] depths;
+    delete [] hits;
+}
+
+// Record a data memory access. A single access updates the LRU stack of its
+// set for every set count so that miss rates of all cache sizes and
+// associativities are obtained in one pass.
+void stack_dist_t::access(uint64_t m_addr) {
+    uint64_t block = m_addr >> block_offset;
+    num_accesses++;
+
+    for(unsigned l = 0; l <= max_set_bits; l++) {
+        uint64_t set = ((uint64_t(1) << l) - 1) + (block & ((uint64_t(1) << l) - 1));
+        uint64_t *stack = &stacks[set * max_ways];
+        unsigned depth = depths[set];
+        // Find the stack position of the block.
+        unsigned pos = 0;
+        while((pos < depth) && (stack[pos] != block)) { pos++; }
+        if(pos < depth) { hits[l * max_ways + pos]++; }
+        else { pos = (depth < max_ways) ? depths[set]++ : max_ways - 1; }
+        // Move the block to the top of the stack.
+        memmove(stack + 1, stack, pos * sizeof(uint64_t));
+        stack[0] = block;
+    }
+
+    // Update the fully-associative reuse distance.
+    update_reuse(block);
+}
+
+// Update the reuse distance of a block. The reuse distance is the number of
+// distinct blocks accessed since the last access to the block, which equals
+// the number of last access markers placed after its own marker.
+void stack_dist_t::update_reuse(uint64_t m_block) {
+    // Make room for a new timestamp.
+    if(time == time_block.size()) { compact(); }
+
+    unordered_map<uint64_t, uint64_t>::iterator it = last_access.find(m_block);
+    if(it == last_access.end()) {
+        num_cold++;
+        it = last_access.insert(pair<uint64_t, uint64_t>(m_block, 0)).first;
+    }
+    else {
+        // Count markers up to the last access of the block.
+        uint64_t count = 0;
+        for(uint64_t i = it->second + 1; i; i -= i & -i) { count += tree[i]; }
+        uint64_t dist = last_access.size() - count;
+        unsigned bucket = 0;
+        while(dist) { dist = dist >> 1; bucket++; }
+        reuse_hist[bucket]++;
+        // Remove the marker of the previous access.
+        for(uint64_t i = it->second + 1; i < tree.size(); i += i & -i) { tree[i]--; }
+    }
+    // Place a marker at the current access.
+    for(uint64_t i = time + 1; i < tree.size(); i += i & -i) { tree[i]++; }
+    it->second = time;
+    time_block[time++] = m_block;
+}
+
+// Renumber reuse timestamps. Only the last access of each block keeps a
+// marker, so timestamps are compacted to the number of distinct blocks, and
+// the Fenwick tree is rebuilt with room to grow.
+void stack_dist_t::compact() {
+    uint64_t new_time = 0;
+    for(uint64_t t = 0; t < time; t++) {
+        uint64_t &last = last_access[time_block[t]];
+        if(last == t) { last = new_time; time_block[new_time++] = time_block[t]; }
+    }
+    time = new_time;
+    uint64_t capacity = (time << 1) + (1 << 16);
+    time_block.resize(capacity);
+    tree.assign(capacity + 1, 0);
+    for(uint64_t i = 1; i <= capacity; i++) {
+        if(i <= time) { tree[i]++; }
+        uint64_t j = i + (i & -i);
+        if(j <= capacity) { tree[j] += tree[i]; }
+    }
+}
+
+// Print miss-rate curves and reuse distances.
+void stack_dist_t::print_stats() {
+    cout << endl << "Stack distance analysis (block size = " << block_size << "B):" << endl;
+    cout << "    Number of accesses = " << num_accesses << endl;
+    cout << "    Number of distinct blocks = " << num_cold << endl;
+
+    // Print miss rates of LRU caches for all cache sizes and associativities.
+    unsigned way_bits = 0;
+    while((1u << way_bits) < max_ways) { way_bits++; }
+    cout << endl << "    Miss rate by cache size and associativity:" << endl;
+    cout << "    " << setw(10) << "size";
+    for(unsigned w = 0; w <= way_bits; w++) {
+        stringstream ss; ss << (1u << w) << "-way";
+        cout << setw(9) << ss.str();
+    }
+    cout << setw(9) << "full" << endl;
+    cout.precision(3);
+    for(unsigned k = 0; k <= max_set_bits + way_bits; k++) {
+        cout << "    " << setw(10) << get_size_str(block_size << k);
+        for(unsigned w = 0; w <= way_bits; w++) {
+            // The number of sets is 2^(k-w).
+            if((w > k) || (k - w > max_set_bits)) { cout << setw(9) << "-"; continue; }
+            uint64_t num_hits = 0;
+            for(unsigned d = 0; d < (1u << w); d++) { num_hits += hits[(k - w) * max_ways + d]; }
+            cout << setw(9) << fixed
+                 << (num_accesses ? double(num_accesses - num_hits) / double(num_accesses) : 0);
+        }
+        // A fully-associative cache of 2^k blocks misses on reuse distances of 2^k or more.
+        uint64_t num_misses = num_cold;
+        for(unsigned b = k + 1; b < reuse_hist.size(); b++) { num_misses += reuse_hist[b]; }
+        cout << setw(9) << fixed
+             << (num_accesses ? double(num_misses) / double(num_accesses) : 0) << endl;
+    }
+
+    // Print the histogram of reuse distances.
+    cout << endl << "    Reuse distance histogram (in blocks):" << endl;
+    for(unsigned b = 0; b < reuse_hist.size(); b++) {
+        if(!reuse_hist[b]) { continue; }
+        stringstream ss;
+        if(b < 2) { ss << "[" << (b ? 1 : 0) << "]"; }
+        else { ss << "[" << (uint64_t(1) << (b - 1)) << ", " << ((uint64_t(1) << b) - 1) << "]"; }
+        cout << "    " << setw(24) << ss.str() << " = " << reuse_hist[b] << " ("
+             << fixed << (double(reuse_hist[b]) / double(num_accesses)) << ")" << endl;
+    }
+    if(num_cold) {
+        cout << "    " << setw(24) << "cold" << " = " << num_cold << " ("
+             << fixed << (double(num_cold) / double(num_accesses)) << ")" << endl;
+    }
+    cout.precision(-1);
+}
+// Register stack distance stats.
+void stack_dist_t::register_stats(stats_t *m_stats, const string &m_prefix) {
+    m_stats->add_counter(m_prefix + ".accesses", &num_accesses, "Number of accesses");
+    m_stats->add_counter(m_prefix + ".cold", &num_cold, "Number of distinct blocks");
+    m_stats->add_histogram(m_prefix + ".reuse_hist", &reuse_hist,
+                           "Log2 histogram of reuse distances in blocks");
+}
+
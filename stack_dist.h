@@ -0,0 +1,49 @@
+#ifndef __KITE_STACK_DIST_H__
+#define __KITE_STACK_DIST_H__
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class stats_t;
+
+// LRU stack distance analyzer
+class stack_dist_t {
+public:
+    stack_dist_t(uint64_t m_block_size, unsigned m_max_set_bits = 14, unsigned m_max_ways = 16);
+    ~stack_dist_t();
+
+    void access(uint64_t m_addr);               // Record a data memory access.
+    void print_stats();                         // Print miss-rate curves and reuse distances.
+    void register_stats(stats_t *m_stats, const std::string &m_prefix);   // Register stats.
+
+private:
+    void update_reuse(uint64_t m_block);        // Update the reuse distance of a block.
+    void compact();                             // Renumber reuse timestamps.
+
+    uint64_t block_size;                        // Block size in bytes
+    unsigned block_offset;                      // Block offset
+    unsigned max_set_bits;                      // Set counts of 2^0 to 2^max_set_bits are analyzed.
+    unsigned max_ways;                          // Depth of the LRU stack per set
+
+    // Per-set LRU stacks for each set count, truncated at max_ways blocks.
+    // Stacks of all set counts are kept in a single array.
+    uint64_t *stacks;                           // LRU stacks (MRU first)
+    unsigned *depths;                           // Number of blocks in each stack
+    uint64_t *hits;                             // Hit counts at each stack position per set count
+
+    // Fully-associative reuse distances are counted with a Fenwick tree that
+    // marks the last access time of each block.
+    std::unordered_map<uint64_t, uint64_t> last_access;   // Last access time of each block
+    std::vector<uint64_t> tree;                 // Fenwick tree of last access markers
+    std::vector<uint64_t> time_block;           // Block accessed at each time
+    uint64_t time;                              // Current access time
+    std::vector<uint64_t> reuse_hist;           // Log2 histogram of reuse distances
+
+    uint64_t num_accesses;                      // Number of accesses
+    uint64_t num_cold;                          // Number of first accesses to blocks
+};
+
+#endif
+
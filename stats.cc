@@ -0,0 +1,318 @@
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include "stats.h"
+
+using namespace std;
+
+// Does a file name end with the .json extension?
+static bool is_json_file(const char *m_file) {
+    size_t len = strlen(m_file);
+    return (len >= 5) && !strcmp(m_file + len - 5, ".json");
+}
+
+stats_t::stats_t() :
+    dump_json(false),
+    interval(0),
+    position(0),
+    next_dump(0),
+    last_dump(0),
+    num_dumps(0) {
+}
+
+stats_t::~stats_t() {
+    close_dump();
+}
+
+// Register a counter.
+void stats_t::add_counter(const string &m_name, const uint64_t *m_value, const string &m_desc) {
+    stat_t stat;
+    stat.name    = m_name;
+    stat.desc    = m_desc;
+    stat.type    = stat_counter;
+    stat.value   = m_value;
+    stat.buckets = 0;
+    stat.last    = 0;
+    add(stat);
+}
+
+// Register a histogram.
+void stats_t::add_histogram(const string &m_name, const vector<uint64_t> *m_buckets,
+                            const string &m_desc) {
+    stat_t stat;
+    stat.name    = m_name;
+    stat.desc    = m_desc;
+    stat.type    = stat_histogram;
+    stat.value   = 0;
+    stat.buckets = m_buckets;
+    stat.last    = 0;
+    add(stat);
+}
+
+// Register a formula. An empty denominator is one.
+void stats_t::add_formula(const string &m_name, const string &m_num,
+                          const string &m_den, const string &m_desc) {
+    stat_t stat;
+    stat.name    = m_name;
+    stat.desc    = m_desc;
+    stat.type    = stat_formula;
+    stat.value   = 0;
+    stat.buckets = 0;
+    stat.num     = parse_terms(m_num, m_name);
+    stat.den     = parse_terms(m_den, m_name);
+    stat.last    = 0;
+    add(stat);
+}
+
+// Register a configuration parameter, which appears only in the summary.
+void stats_t::add_param(const string &m_name, const string &m_value, const string &m_desc) {
+    stat_t stat;
+    stat.name    = m_name;
+    stat.desc    = m_desc;
+    stat.type    = stat_param;
+    stat.value   = 0;
+    stat.buckets = 0;
+    stat.text    = m_value;
+    stat.last    = 0;
+    add(stat);
+}
+
+// Find a registered statistic.
+size_t stats_t::find(const string &m_name) const {
+    unordered_map<string, size_t>::const_iterator it = index.find(m_name);
+    return it == index.end() ? stats.size() : it->second;
+}
+
+// Add a statistic to the registry.
+void stats_t::add(const stat_t &m_stat) {
+    if(m_stat.name.empty() || (m_stat.name[0] == '.') ||
+       (m_stat.name[m_stat.name.size()-1] == '.')) {
+        cerr << "Error: invalid statistic name " << m_stat.name << endl;
+        exit(1);
+    }
+    if(find(m_stat.name) != stats.size()) {
+        cerr << "Error: duplicate statistic " << m_stat.name << endl;
+        exit(1);
+    }
+    // A name cannot be both a statistic and a group of statistics.
+    for(size_t i = 0; i < stats.size(); i++) {
+        const string &a = stats[i].name, &b = m_stat.name;
+        const string &shorter = a.size() < b.size() ? a : b, &longer = a.size() < b.size() ? b : a;
+        if(!longer.compare(0, shorter.size(), shorter) && (longer[shorter.size()] == '.')) {
+            cerr << "Error: statistic " << b << " conflicts with " << a << endl;
+            exit(1);
+        }
+    }
+    if(interval) {
+        cerr << "Error: statistic " << m_stat.name << " registered after dumps started" << endl;
+        exit(1);
+    }
+    index[m_stat.name] = stats.size();
+    stats.push_back(m_stat);
+}
+
+// Parse a weighted sum of counters, e.g., "a + b - 2*c".
+vector<stat_term_t> stats_t::parse_terms(const string &m_expr, const string &m_name) const {
+    vector<stat_term_t> terms;
+    stringstream ss(m_expr);
+    string token;
+    int64_t sign = 1;
+    bool expect_term = true;
+    bool valid = true;
+    while(valid && (ss >> token)) {
+        if(!expect_term) {
+            // An operator separates terms.
+            valid = (token == "+") || (token == "-");
+            sign = (token == "-") ? -1 : 1;
+            expect_term = true;
+            continue;
+        }
+        stat_term_t term;
+        term.coeff = sign;
+        // A term has an optional integer coefficient.
+        size_t mul = token.find('*');
+        if(mul != string::npos) {
+            char *end;
+            term.coeff *= strtoll(token.c_str(), &end, 10);
+            valid = mul && (end == token.c_str() + mul);
+            token = token.substr(mul + 1);
+        }
+        term.index = find(token);
+        if(valid && ((term.index == stats.size()) || (stats[term.index].type != stat_counter))) {
+            cerr << "Error: unknown counter " << token << " in statistic " << m_name << endl;
+            exit(1);
+        }
+        terms.push_back(term);
+        expect_term = false;
+    }
+    if(!valid || (expect_term && terms.size())) {
+        cerr << "Error: invalid formula " << m_expr << " in statistic " << m_name << endl;
+        exit(1);
+    }
+    return terms;
+}
+
+// Evaluate a formula over the totals or the current interval.
+double stats_t::eval(const stat_t &m_stat, bool m_interval) const {
+    double num = 0, den = m_stat.den.size() ? 0 : 1;
+    for(size_t i = 0; i < m_stat.num.size(); i++) {
+        const stat_t &counter = stats[m_stat.num[i].index];
+        num += double(m_stat.num[i].coeff) * double(*counter.value - (m_interval ? counter.last : 0));
+    }
+    for(size_t i = 0; i < m_stat.den.size(); i++) {
+        const stat_t &counter = stats[m_stat.den[i].index];
+        den += double(m_stat.den[i].coeff) * double(*counter.value - (m_interval ? counter.last : 0));
+    }
+    return den ? num / den : 0;
+}
+
+// Open a CSV or JSON time series that dumps every m_interval units of a counter.
+void stats_t::open_dump(const char *m_file, uint64_t m_interval, const string &m_unit) {
+    size_t unit = find(m_unit);
+    if((unit == stats.size()) || (stats[unit].type != stat_counter)) {
+        cerr << "Error: unknown counter " << m_unit << " for stats interval" << endl;
+        exit(1);
+    }
+    if(!m_interval) {
+        cerr << "Error: stats interval must be positive" << endl;
+        exit(1);
+    }
+    dump_file.open(m_file);
+    if(!dump_file.is_open()) {
+        cerr << "Error: failed to open " << m_file << endl;
+        exit(1);
+    }
+    dump_json = is_json_file(m_file);
+    interval  = m_interval;
+    position  = stats[unit].value;
+    last_dump = *position;
+    next_dump = last_dump + interval;
+    for(size_t i = 0; i < stats.size(); i++) {
+        if(stats[i].type == stat_counter) { stats[i].last = *stats[i].value; }
+    }
+
+    // A JSON time series is an array of interval objects, and a CSV time
+    // series has a header row of counter and formula names.
+    if(dump_json) { dump_file << "["; }
+    else {
+        dump_file << "interval,end";
+        for(size_t i = 0; i < stats.size(); i++) {
+            if((stats[i].type == stat_counter) || (stats[i].type == stat_formula)) {
+                dump_file << "," << stats[i].name;
+            }
+        }
+        dump_file << endl;
+    }
+}
+
+// Dump the current interval. Counters are dumped as deltas over the interval,
+// and formulas are evaluated over the deltas.
+void stats_t::dump() {
+    if(dump_json) { dump_file << (num_dumps ? "," : "") << endl << "  {\"interval\": " << num_dumps; }
+    else { dump_file << num_dumps; }
+    dump_file << (dump_json ? ", \"end\": " : ",") << *position;
+    for(size_t i = 0; i < stats.size(); i++) {
+        const stat_t &stat = stats[i];
+        if((stat.type == stat_histogram) || (stat.type == stat_param)) { continue; }
+        if(dump_json) { dump_file << ", \"" << stat.name << "\": "; }
+        else { dump_file << ","; }
+        if(stat.type == stat_counter) { dump_file << (*stat.value - stat.last); }
+        else { dump_file << eval(stat, true); }
+    }
+    dump_file << (dump_json ? "}" : "\n");
+    // Start the next interval.
+    for(size_t i = 0; i < stats.size(); i++) {
+        if(stats[i].type == stat_counter) { stats[i].last = *stats[i].value; }
+    }
+    last_dump = *position;
+    while(next_dump <= last_dump) { next_dump += interval; }
+    num_dumps++;
+}
+
+// Dump the last partial interval, and close the time series.
+void stats_t::close_dump() {
+    if(!interval) { return; }
+    if(*position > last_dump) { dump(); }
+    if(dump_json) { dump_file << endl << "]" << endl; }
+    dump_file.close();
+    interval = 0;
+}
+
+// Write the final values of statistics. A JSON summary nests statistics by
+// the components of their names, and a CSV summary lists name, value, and
+// description rows.
+void stats_t::write_summary(const char *m_file) const {
+    ofstream out(m_file);
+    if(!out.is_open()) {
+        cerr << "Error: failed to open " << m_file << endl;
+        exit(1);
+    }
+    if(is_json_file(m_file)) {
+        vector<size_t> group;
+        for(size_t i = 0; i < stats.size(); i++) { group.push_back(i); }
+        write_group(out, group, 0, 0);
+        out << endl;
+        return;
+    }
+    out << "name,value,description" << endl;
+    for(size_t i = 0; i < stats.size(); i++) {
+        const stat_t &stat = stats[i];
+        if(stat.type == stat_histogram) {
+            // Each histogram bucket is a row.
+            for(size_t b = 0; b < stat.buckets->size(); b++) {
+                out << stat.name << "[" << b << "]," << (*stat.buckets)[b]
+                    << ",\"" << stat.desc << "\"" << endl;
+            }
+            continue;
+        }
+        out << stat.name << ",";
+        if(stat.type == stat_counter) { out << *stat.value; }
+        else if(stat.type == stat_param) { out << stat.text; }
+        else { out << eval(stat, false); }
+        out << ",\"" << stat.desc << "\"" << endl;
+    }
+}
+
+// Write a group of statistics that share the first m_prefix characters of
+// names as nested JSON objects. Subgroups keep their registration order.
+void stats_t::write_group(ofstream &m_out, const vector<size_t> &m_group,
+                          size_t m_prefix, unsigned m_indent) const {
+    vector<pair<string, vector<size_t> > > keys;
+    for(size_t i = 0; i < m_group.size(); i++) {
+        const string &name = stats[m_group[i]].name;
+        size_t dot = name.find('.', m_prefix);
+        string key = name.substr(m_prefix, dot == string::npos ? string::npos : dot - m_prefix);
+        size_t k = 0;
+        while((k < keys.size()) && (keys[k].first != key)) { k++; }
+        if(k == keys.size()) { keys.push_back(make_pair(key, vector<size_t>())); }
+        keys[k].second.push_back(m_group[i]);
+    }
+
+    string indent((m_indent + 1) * 2, ' ');
+    m_out << "{";
+    for(size_t k = 0; k < keys.size(); k++) {
+        m_out << (k ? "," : "") << endl << indent << "\"" << keys[k].first << "\": ";
+        const stat_t &stat = stats[keys[k].second[0]];
+        if((keys[k].second.size() > 1) || (stat.name.size() > m_prefix + keys[k].first.size())) {
+            write_group(m_out, keys[k].second, m_prefix + keys[k].first.size() + 1, m_indent + 1);
+        }
+        else if(stat.type == stat_counter) { m_out << *stat.value; }
+        else if(stat.type == stat_formula) { m_out << eval(stat, false); }
+        else if(stat.type == stat_param) {
+            // Numbers and booleans are JSON values, and others are strings.
+            bool number = stat.text.size() && (stat.text.find_first_not_of("0123456789") == string::npos);
+            if(number || (stat.text == "true") || (stat.text == "false")) { m_out << stat.text; }
+            else { m_out << "\"" << stat.text << "\""; }
+        }
+        else {
+            m_out << "[";
+            for(size_t b = 0; b < stat.buckets->size(); b++) {
+                m_out << (b ? ", " : "") << (*stat.buckets)[b];
+            }
+            m_out << "]";
+        }
+    }
+    m_out << endl << string(m_indent * 2, ' ') << "}";
+}
+
@@ -0,0 +1,87 @@
+#ifndef __KITE_STATS_H__
+#define __KITE_STATS_H__
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Statistic types
+enum stat_type {
+    stat_counter = 0,                       // Scalar counter
+    stat_histogram,                         // Array of bucket counters
+    stat_formula,                           // Ratio of weighted sums of counters
+    stat_param,                             // Configuration parameter
+};
+
+// Weighted counter term of a formula
+struct stat_term_t {
+    int64_t coeff;                          // Coefficient
+    size_t index;                           // Index of the counter in the registry
+};
+
+// Registered statistic
+struct stat_t {
+    std::string name;                       // Hierarchical name (e.g., dcache.misses)
+    std::string desc;                       // Description
+    stat_type type;                         // Statistic type
+    const uint64_t *value;                  // Pointer to a counter
+    const std::vector<uint64_t> *buckets;   // Pointer to histogram buckets
+    std::vector<stat_term_t> num, den;      // Numerator and denominator terms of a formula
+    std::string text;                       // Value of a parameter
+    uint64_t last;                          // Counter value at the last interval dump
+};
+
+// Statistics registry. Components register pointers to the counters they
+// already maintain, so counting stays a plain increment, and the registry
+// reads the counters only when it dumps. Names are dot-separated paths, and
+// formulas are ratios of weighted sums of counters (e.g., "a - 2*b" / "c").
+class stats_t {
+public:
+    stats_t();
+    ~stats_t();
+
+    // Register a counter.
+    void add_counter(const std::string &m_name, const uint64_t *m_value, const std::string &m_desc);
+    // Register a histogram.
+    void add_histogram(const std::string &m_name, const std::vector<uint64_t> *m_buckets,
+                       const std::string &m_desc);
+    // Register a formula. An empty denominator is one.
+    void add_formula(const std::string &m_name, const std::string &m_num,
+                     const std::string &m_den, const std::string &m_desc);
+    // Register a configuration parameter, which appears only in the summary.
+    void add_param(const std::string &m_name, const std::string &m_value, const std::string &m_desc);
+    // Open a CSV or JSON time series that dumps every m_interval units of a counter.
+    void open_dump(const char *m_file, uint64_t m_interval, const std::string &m_unit);
+    // Dump an interval if it has elapsed.
+    void sample() { if(interval && (*position >= next_dump)) { dump(); } }
+    void close_dump();                      // Dump the last partial interval, and close the time series.
+    void write_summary(const char *m_file) const;   // Write the final values as CSV or JSON.
+
+private:
+    size_t find(const std::string &m_name) const;   // Find a registered statistic.
+    void add(const stat_t &m_stat);                 // Add a statistic to the registry.
+    // Parse a weighted sum of counters.
+    std::vector<stat_term_t> parse_terms(const std::string &m_expr, const std::string &m_name) const;
+    // Evaluate a formula over the totals or the current interval.
+    double eval(const stat_t &m_stat, bool m_interval) const;
+    void dump();                            // Dump the current interval.
+    // Write a group of statistics as nested JSON objects.
+    void write_group(std::ofstream &m_out, const std::vector<size_t> &m_group,
+                     size_t m_prefix, unsigned m_indent) const;
+
+    std::vector<stat_t> stats;              // Registered statistics in registration order
+    std::unordered_map<std::string, size_t> index;  // Statistic index by name
+
+    std::ofstream dump_file;                // Time series file
+    bool dump_json;                         // Is the time series in JSON?
+    uint64_t interval;                      // Dump interval (0 to disable dumps)
+    const uint64_t *position;               // Counter that measures intervals
+    uint64_t next_dump;                     // Position of the next dump
+    uint64_t last_dump;                     // Position of the last dump
+    uint64_t num_dumps;                     // Number of dumped intervals
+};
+
+#endif
+
@@ -0,0 +1,164 @@
+#include <iostream>
+#include "stats.h"
+#include "store_buffer.h"
+
+using namespace std;
+
+store_buffer_t::store_buffer_t(uint64_t *m_ticks, data_cache_t *m_data_cache, uint64_t m_entries,
+                               bool m_store_sets, uint64_t m_ssit_entries, unsigned m_num_threads) :
+    ticks(m_ticks),
+    data_cache(m_data_cache),
+    num_entries(m_entries),
+    drain_inst(0),
+    store_sets(m_store_sets),
+    ssit(m_num_threads, vector<uint64_t>(m_ssit_entries, 0)),
+    next_ssid(1),
+    num_stores(0),
+    num_full_stalls(0),
+    num_loads(0),
+    num_searches(0),
+    num_forwards(0),
+    num_violations(0) {
+}
+
+store_buffer_t::~store_buffer_t() {
+    for(size_t i = 0; i < entries.size(); i++) { delete entries[i].inst; }
+}
+
+// Is the store buffer empty?
+bool store_buffer_t::is_empty() const {
+    return entries.empty();
+}
+
+// Is a store waiting for a data cache miss?
+bool store_buffer_t::is_draining() const {
+    return drain_inst;
+}
+
+// Is there a free entry for a store?
+bool store_buffer_t::can_push() {
+    if(entries.size() < num_entries) { return true; }
+    // The store waits for a free entry.
+    num_full_stalls++;
+    return false;
+}
+
+// Buffer a store. The buffer keeps a copy of the store that retires.
+void store_buffer_t::push(inst_t *m_inst) {
+    sb_entry_t entry = { new inst_t(*m_inst), *ticks };
+    entries.push_back(entry);
+    num_stores++;
+}
+
+// Get the store set ID of an instruction.
+uint64_t& store_buffer_t::get_ssid(const inst_t *m_inst) {
+    vector<uint64_t> &table = ssit[m_inst->tid];
+    return table[(m_inst->pc >> 2) & (table.size() - 1)];
+}
+
+uint64_t store_buffer_t::get_ssid(const inst_t *m_inst) const {
+    const vector<uint64_t> &table = ssit[m_inst->tid];
+    return table[(m_inst->pc >> 2) & (table.size() - 1)];
+}
+
+// Find the youngest buffered store to an address.
+inst_t* store_buffer_t::find(uint64_t m_addr) const {
+    for(deque<sb_entry_t>::const_reverse_iterator it = entries.rbegin(); it != entries.rend(); it++) {
+        if(it->inst->memory_addr == m_addr) { return it->inst; }
+    }
+    return 0;
+}
+
+// Does a load search the buffer? With store sets, it searches if it is in
+// the store set of a buffered store.
+bool store_buffer_t::is_searched(const inst_t *m_inst) const {
+    if(!store_sets) { return true; }
+    uint64_t load_ssid = get_ssid(m_inst);
+    for(size_t i = 0; load_ssid && (i < entries.size()); i++) {
+        if(get_ssid(entries[i].inst) == load_ssid) { return true; }
+    }
+    return false;
+}
+
+// Will a load to an address take the value of a buffered store?
+bool store_buffer_t::can_forward(const inst_t *m_inst, uint64_t m_addr) const {
+    return is_searched(m_inst) && find(m_addr);
+}
+
+// Look up a load, and return true if it takes the value of a buffered store.
+bool store_buffer_t::read(inst_t *m_inst) {
+    num_loads++;
+    inst_t *store = find(m_inst->memory_addr);
+    bool search = is_searched(m_inst);
+    num_searches += search;
+    if(!store) { return false; }
+    if(search) {
+        m_inst->rd_val = store->rs2_val;
+        num_forwards++;
+        return true;
+    }
+    // The load runs ahead of the store. Put both of them in the same store set.
+    uint64_t &load_ssid = get_ssid(m_inst);
+    uint64_t &store_ssid = get_ssid(store);
+    if(!load_ssid && !store_ssid) { load_ssid = store_ssid = next_ssid++; }
+    else if(!load_ssid) { load_ssid = store_ssid; }
+    else if(!store_ssid) { store_ssid = load_ssid; }
+    else { load_ssid = store_ssid = load_ssid < store_ssid ? load_ssid : store_ssid; }
+    m_inst->order_violation = true;
+    num_violations++;
+    return false;
+}
+
+// Write the oldest store to the data cache if it has retired and the memory
+// stage does not use the cache port. A store that misses holds the cache
+// until the block arrives.
+void store_buffer_t::run(bool m_port_free) {
+    if(drain_inst && data_cache->is_free()) {
+        delete drain_inst;
+        entries.pop_front();
+        drain_inst = 0;
+    }
+    if(!drain_inst && entries.size() && (*ticks > entries.front().push_ticks) &&
+       m_port_free && data_cache->is_free()) {
+        inst_t *store = entries.front().inst;
+        data_cache->write(store);
+        if(data_cache->is_free()) {
+            delete store;
+            entries.pop_front();
+        }
+        else { drain_inst = store; }
+    }
+}
+
+// Print store buffer stats.
+void store_buffer_t::print_stats() {
+    cout << endl << "Store buffer stats:" << endl;
+    cout.precision(3);
+    cout << "    Number of buffered stores = " << num_stores << endl;
+    cout << "    Full buffer stall cycles = " << num_full_stalls << endl;
+    cout << "    Number of loads = " << num_loads << endl;
+    cout << "    Loads searching the buffer = " << num_searches << endl;
+    cout << "    Forwarded loads = " << num_forwards << " (" << fixed
+         << (num_loads ? double(num_forwards) / double(num_loads) : 0) << ")" << endl;
+    cout << "    Mis-speculated loads = " << num_violations << " (" << fixed
+         << (num_loads ? double(num_violations) / double(num_loads) : 0) << ")" << endl;
+    cout.precision(-1);
+}
+
+// Register store buffer stats.
+void store_buffer_t::register_stats(stats_t *m_stats, const string &m_prefix) {
+    m_stats->add_counter(m_prefix + ".stores", &num_stores, "Number of buffered stores");
+    m_stats->add_counter(m_prefix + ".full_stalls", &num_full_stalls,
+                         "Cycles that a store waits for a free entry");
+    m_stats->add_counter(m_prefix + ".loads", &num_loads, "Number of loads");
+    m_stats->add_counter(m_prefix + ".searches", &num_searches,
+                         "Number of loads that search the buffer");
+    m_stats->add_counter(m_prefix + ".forwards", &num_forwards,
+                         "Number of loads forwarded from the buffer");
+    m_stats->add_counter(m_prefix + ".violations", &num_violations,
+                         "Number of loads that ran ahead of a buffered store to the same address");
+    m_stats->add_formula(m_prefix + ".forward_rate", m_prefix + ".forwards", m_prefix + ".loads",
+                         "Fraction of loads forwarded from the buffer");
+    m_stats->add_formula(m_prefix + ".violation_rate", m_prefix + ".violations", m_prefix + ".loads",
+                         "Fraction of loads mis-speculated");
+}
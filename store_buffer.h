@@ -0,0 +1,72 @@
+#ifndef __KITE_STORE_BUFFER_H__
+#define __KITE_STORE_BUFFER_H__
+
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <vector>
+#include "data_cache.h"
+#include "inst.h"
+
+class stats_t;
+
+// Store buffer entry
+struct sb_entry_t {
+    inst_t *inst;                           // Buffered store (owned)
+    uint64_t push_ticks;                    // Clock ticks that the store was buffered
+};
+
+// Store buffer. Stores leave the memory stage into the buffer, and the
+// oldest store is written to the data cache after it retires when the cache
+// port is free. A load waiting for the port goes ahead of the stores.
+// A load takes the value of the youngest buffered store to the same address.
+// With store sets, only a load predicted to depend on a buffered store
+// searches the buffer. A load that reads the data cache ahead of an older
+// buffered store to the same address is mis-speculated, and the load and
+// the store are put in the same store set. Each thread has its own store
+// set ID table.
+class store_buffer_t {
+public:
+    store_buffer_t(uint64_t *m_ticks, data_cache_t *m_data_cache, uint64_t m_entries,
+                   bool m_store_sets, uint64_t m_ssit_entries, unsigned m_num_threads);
+    ~store_buffer_t();
+
+    bool is_empty() const;                  // Is the store buffer empty?
+    bool is_draining() const;               // Is a store waiting for a data cache miss?
+    bool can_push();                        // Is there a free entry for a store?
+    void push(inst_t *m_inst);              // Buffer a store.
+    // Will a load to an address take the value of a buffered store?
+    bool can_forward(const inst_t *m_inst, uint64_t m_addr) const;
+    // Look up a load, and return true if it takes the value of a buffered store.
+    bool read(inst_t *m_inst);
+    void run(bool m_port_free);             // Write the oldest store to the data cache.
+    void print_stats();                     // Print store buffer stats.
+    void register_stats(stats_t *m_stats, const std::string &m_prefix);   // Register stats.
+
+private:
+    uint64_t &get_ssid(const inst_t *m_inst);       // Get the store set ID of an instruction.
+    uint64_t get_ssid(const inst_t *m_inst) const;
+    inst_t* find(uint64_t m_addr) const;            // Find the youngest store to an address.
+    bool is_searched(const inst_t *m_inst) const;   // Does a load search the buffer?
+
+    uint64_t *ticks;                        // Pointer to processor clock ticks
+    data_cache_t *data_cache;               // Data cache
+    std::deque<sb_entry_t> entries;         // Buffered stores in program order
+    uint64_t num_entries;                   // Number of entries
+    inst_t *drain_inst;                     // Store waiting for a data cache miss
+    bool store_sets;                        // Predict memory dependences with store sets?
+    // Store set ID tables per thread indexed by PC (0 if none)
+    std::vector<std::vector<uint64_t> > ssit;
+    uint64_t next_ssid;                     // Next store set ID to assign
+
+    // Stats
+    uint64_t num_stores;                    // Number of buffered stores
+    uint64_t num_full_stalls;               // Cycles that a store waits for a free entry
+    uint64_t num_loads;                     // Number of loads
+    uint64_t num_searches;                  // Number of loads that search the buffer
+    uint64_t num_forwards;                  // Number of loads forwarded from the buffer
+    uint64_t num_violations;                // Number of loads ahead of a matching store
+};
+
+#endif
+
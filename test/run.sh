@@ -0,0 +1,49 @@
+#!/bin/bash
+# Kite functional checks
+#
+# Runs each check below, and prints OK or FAIL for each of them. A check runs
+# a program under test/ with and without an option, and compares the final
+# register and memory states and the stats that the option has to produce.
+#
+# Usage: test/run.sh
+
+cd "$(dirname "$0")"
+kite=../kite
+fail=0
+
+if [ ! -x $kite ]; then
+    echo "Error: $kite not found" >&2
+    exit 1
+fi
+
+# Print the final register and memory states.
+state() { awk '/^Register state:/ { p = 1 } /End of Pipeline/ { p = 0 } p'; }
+# Print the count of a stat line (e.g., "Forwarded loads = 12 (0.500)").
+stat() { awk -v key="$1" 'index($0, key) == 1 { print $(NF-1); exit }'; }
+
+# Report a check result.
+check() {
+    if eval "$2"; then echo "OK   $1"; else echo "FAIL $1"; fail=1; fi
+}
+
+# Store buffer: buffered stores must not change the program results. With
+# store sets, a load first runs ahead of a buffered store to the same address
+# and is refetched, and later loads take the buffered value. Without store
+# sets, every load searches the buffer and none is mis-speculated.
+dir=store_buffer
+opts="--memory.latency=20 --sb.entries=8"
+ref=$(cd $dir && ../$kite --no-asm-cache --memory.latency=20 program_code 2>&1)
+sets=$(cd $dir && ../$kite --no-asm-cache $opts program_code 2>&1)
+search=$(cd $dir && ../$kite --no-asm-cache $opts --sb.store_sets=false program_code 2>&1)
+check "$dir: states with store sets" '[ "$(echo "$ref" | state)" = "$(echo "$sets" | state)" ]'
+check "$dir: states without store sets" '[ "$(echo "$ref" | state)" = "$(echo "$search" | state)" ]'
+check "$dir: mis-speculated loads with store sets" \
+      '[ "$(echo "$sets" | stat "    Mis-speculated loads")" -gt 0 ]'
+check "$dir: forwarded loads with store sets" \
+      '[ "$(echo "$sets" | stat "    Forwarded loads")" -gt 0 ]'
+check "$dir: forwarded loads without store sets" \
+      '[ "$(echo "$search" | stat "    Forwarded loads")" -gt 0 ]'
+check "$dir: mis-speculated loads without store sets" \
+      '[ "$(echo "$search" | stat "    Mis-speculated loads")" -eq 0 ]'
+
+exit $fail
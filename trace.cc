@@ -0,0 +1,158 @@
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <unordered_map>
+#include <vector>
+#include "trace.h"
+
+using namespace std;
+
+trace_t::trace_t(uint64_t *m_ticks, inst_memory_t *m_inst_memory, const char *m_file,
+                 uint64_t m_start, uint64_t m_end) :
+    ticks(m_ticks),
+    inst_memory(m_inst_memory),
+    start(m_start),
+    end(m_end),
+    buffer(0),
+    num_buffered(0),
+    num_records(0) {
+    file.open(m_file, ios::binary);
+    if(!file.is_open()) {
+        cerr << "Error: failed to open " << m_file << endl;
+        exit(1);
+    }
+    // Reserve space for the header, which is written when the trace is closed.
+    trace_header_t header;
+    memset(&header, 0, sizeof(header));
+    file.write((const char*)&header, sizeof(header));
+    buffer = new trace_record_t[trace_buffer_size];
+}
+
+trace_t::~trace_t() {
+    write_buffer();
+    delete [] buffer;
+
+    // Write the instruction string table.
+    trace_header_t header;
+    memset(&header, 0, sizeof(header));
+    strncpy(header.magic, trace_magic, sizeof(header.magic));
+    header.version      = trace_version;
+    header.num_records  = num_records;
+    header.table_offset = file.tellp();
+    header.num_insts    = inst_memory->num_insts();
+    for(uint64_t i = 0; i < header.num_insts; i++) {
+        inst_t *inst = inst_memory->read(i << 2);
+        string str = inst ? get_inst_str(inst) : "";
+        uint32_t len = str.size();
+        file.write((const char*)&len, sizeof(len));
+        file.write(str.data(), len);
+        delete inst;
+    }
+    // Write the header.
+    file.seekp(0);
+    file.write((const char*)&header, sizeof(header));
+    file.close();
+}
+
+// Write buffered records to the file.
+void trace_t::write_buffer() {
+    file.write((const char*)buffer, num_buffered * sizeof(trace_record_t));
+    num_records += num_buffered;
+    num_buffered = 0;
+}
+
+// Convert a binary pipeline trace to the Konata pipeline viewer format. Each
+// traced instruction is labeled with its PC and disassembly, and lane 0 shows
+// its F, D, X, M, and W stages. Retired instructions leave the viewer in the
+// cycle after writeback, and squashed instructions are marked as flushed.
+void convert_trace(const char *m_trace, const char *m_log) {
+    ifstream in(m_trace, ios::binary);
+    if(!in.is_open()) {
+        cerr << "Error: failed to open " << m_trace << endl;
+        exit(1);
+    }
+    trace_header_t header;
+    if(!in.read((char*)&header, sizeof(header)) ||
+       strncmp(header.magic, trace_magic, sizeof(header.magic)) ||
+       (header.version != trace_version)) {
+        cerr << "Error: invalid trace file " << m_trace << endl;
+        exit(1);
+    }
+    // Read the instruction string table.
+    vector<string> insts(header.num_insts);
+    in.seekg(header.table_offset);
+    for(uint64_t i = 0; i < header.num_insts; i++) {
+        uint32_t len = 0;
+        in.read((char*)&len, sizeof(len));
+        insts[i].resize(len);
+        if(len) { in.read(&insts[i][0], len); }
+    }
+    if(!in) {
+        cerr << "Error: truncated trace file " << m_trace << endl;
+        exit(1);
+    }
+
+    ofstream out(m_log);
+    if(!out.is_open()) {
+        cerr << "Error: failed to open " << m_log << endl;
+        exit(1);
+    }
+    static const char *stage_names[] = { "F", "D", "X", "M", "W" };
+    unordered_map<uint64_t, uint64_t> ids;      // Viewer IDs of in-flight instructions
+    vector<uint64_t> retiring;                  // Instructions retiring in the next cycle
+    vector<trace_record_t> records(trace_buffer_size);
+    uint64_t next_id = 0, num_retired = 0, tick = 0;
+    out << "Kanata\t0004\n";
+    in.seekg(sizeof(header));
+    for(uint64_t n = 0; n < header.num_records; ) {
+        uint64_t count = header.num_records - n < trace_buffer_size ?
+                         header.num_records - n : trace_buffer_size;
+        if(!in.read((char*)&records[0], count * sizeof(trace_record_t))) {
+            cerr << "Error: truncated trace file " << m_trace << endl;
+            exit(1);
+        }
+        for(uint64_t r = 0; r < count; r++, n++) {
+            const trace_record_t &rec = records[r];
+            // Advance the clock to the cycle of the event.
+            if(!n) { out << "C=\t" << (tick = rec.tick) << "\n"; }
+            else if(rec.tick > tick) {
+                if(retiring.size()) {
+                    out << "C\t1\n"; tick++;
+                    for(size_t i = 0; i < retiring.size(); i++) {
+                        out << "R\t" << retiring[i] << "\t" << num_retired++ << "\t0\n";
+                    }
+                    retiring.clear();
+                }
+                if(rec.tick > tick) { out << "C\t" << rec.tick - tick << "\n"; tick = rec.tick; }
+            }
+            // An instruction appears at its first event in the trace.
+            unordered_map<uint64_t, uint64_t>::iterator it = ids.find(rec.seq);
+            if(it == ids.end()) {
+                it = ids.insert(make_pair(rec.seq, next_id++)).first;
+                out << "I\t" << it->second << "\t" << rec.seq << "\t0\n";
+                out << "L\t" << it->second << "\t0\t" << rec.pc << ": "
+                    << ((rec.pc >> 2) < insts.size() ? insts[rec.pc >> 2] : "?") << "\n";
+            }
+            uint64_t id = it->second;
+            if(rec.stage == trace_fuse) {
+                out << "L\t" << id << "\t0\t + "
+                    << ((rec.pc >> 2) < insts.size() ? insts[rec.pc >> 2] : "?") << "\n";
+            }
+            else if(rec.stage == trace_flush) {
+                out << "R\t" << id << "\t0\t1\n";
+                ids.erase(it);
+            }
+            else if(rec.stage <= trace_writeback) {
+                out << "S\t" << id << "\t0\t" << stage_names[rec.stage] << "\n";
+                if(rec.stage == trace_writeback) { retiring.push_back(id); ids.erase(it); }
+            }
+        }
+    }
+    if(retiring.size()) {
+        out << "C\t1\n";
+        for(size_t i = 0; i < retiring.size(); i++) {
+            out << "R\t" << retiring[i] << "\t" << num_retired++ << "\t0\n";
+        }
+    }
+}
+
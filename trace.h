@@ -0,0 +1,79 @@
+#ifndef __KITE_TRACE_H__
+#define __KITE_TRACE_H__
+
+#include <cstdint>
+#include <fstream>
+#include "inst_memory.h"
+
+// A pipeline trace starts with a header, followed by fixed-size records of
+// pipeline events in cycle order and a table of instruction strings indexed
+// by PC/4. Each table entry is a 32-bit length followed by the string.
+#define trace_magic         "KITETRC"
+#define trace_version       1
+#define trace_buffer_size   (1 << 14)
+
+// Pipeline events of an instruction
+enum trace_stage {
+    trace_fetch = 0,                        // Fetched into the IF/ID pipeline register
+    trace_decode,                           // Decoded (including data hazard stalls)
+    trace_execute,                          // Started execution in the ALU
+    trace_memory,                           // Entered the memory stage
+    trace_writeback,                        // Retired in the writeback stage
+    trace_flush,                            // Squashed by a pipeline flush
+    trace_fuse,                             // Fused with the next instruction (pc of the second one)
+    num_trace_stages,
+};
+
+// Trace file header
+struct trace_header_t {
+    char magic[8];                          // Magic string
+    uint64_t version;                       // Trace format version
+    uint64_t num_records;                   // Number of event records
+    uint64_t table_offset;                  // File offset of the instruction string table
+    uint64_t num_insts;                     // Number of entries in the instruction string table
+};
+
+// Trace event record
+struct trace_record_t {
+    uint64_t tick;                          // Clock tick of the event
+    uint64_t seq;                           // Instruction sequence number in fetch order
+    uint32_t pc;                            // Program counter
+    uint32_t stage;                         // Pipeline event
+};
+
+// Binary pipeline trace. Events are buffered and written in large blocks, and
+// only events within the [start, end) cycle window are recorded.
+class trace_t {
+public:
+    trace_t(uint64_t *m_ticks, inst_memory_t *m_inst_memory, const char *m_file,
+            uint64_t m_start = 0, uint64_t m_end = 0);
+    ~trace_t();
+
+    // Record a pipeline event of an instruction.
+    void record(uint64_t m_seq, uint64_t m_pc, trace_stage m_stage) {
+        if((*ticks < start) || (end && (*ticks >= end))) { return; }
+        trace_record_t &rec = buffer[num_buffered++];
+        rec.tick  = *ticks;
+        rec.seq   = m_seq;
+        rec.pc    = m_pc;
+        rec.stage = m_stage;
+        if(num_buffered == trace_buffer_size) { write_buffer(); }
+    }
+
+private:
+    void write_buffer();                    // Write buffered records to the file.
+
+    uint64_t *ticks;                        // Pointer to processor clock ticks
+    inst_memory_t *inst_memory;             // Instruction memory for the string table
+    std::ofstream file;                     // Trace file
+    uint64_t start, end;                    // Cycle window to trace (end = 0 for no end)
+    trace_record_t *buffer;                 // Record buffer
+    uint64_t num_buffered;                  // Number of buffered records
+    uint64_t num_records;                   // Number of written records
+};
+
+// Convert a binary pipeline trace to the Konata pipeline viewer format.
+void convert_trace(const char *m_trace, const char *m_log);
+
+#endif
+
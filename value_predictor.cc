@@ -0,0 +1,163 @@
+#include <algorithm>
+#include <iostream>
+#include "stats.h"
+#include "value_predictor.h"
+
+using namespace std;
+
+// Fold a value into the bits of a context.
+static uint64_t fold_value(int64_t m_value) {
+    uint64_t value = m_value;
+    return (value ^ (value >> 16) ^ (value >> 32) ^ (value >> 48)) & ((1 << vp_ctx_shift) - 1);
+}
+
+// Update a confidence counter.
+static void update_conf(unsigned &m_conf, bool m_correct) {
+    if(!m_correct) { m_conf = 0; }
+    else if(m_conf < vp_max_confidence) { m_conf++; }
+}
+
+value_predictor_t::value_predictor_t(vp_type m_type, uint64_t m_entries, unsigned m_threshold) :
+    type(m_type),
+    threshold(m_threshold),
+    num_loads(0),
+    num_predicts(0),
+    num_correct(0),
+    num_speculated(0),
+    num_squashes(0) {
+    vp_entry_t entry = { 0, 0, 0, 0, 0, 0 };
+    entries.resize(m_entries, entry);
+    // The context table has four entries per load.
+    if(type == vp_context) {
+        vp_ctx_entry_t ctx_entry = { 0, 0 };
+        ctx_entries.resize(m_entries << 2, ctx_entry);
+    }
+}
+
+value_predictor_t::~value_predictor_t() {
+}
+
+// Get the entry of a load. Threads index the table at different offsets.
+vp_entry_t& value_predictor_t::get_entry(const inst_t *m_inst) {
+    uint64_t index = (m_inst->pc >> 2) ^ (uint64_t(m_inst->tid) * 0x9e3779b97f4a7c15ull);
+    return entries[index & (entries.size() - 1)];
+}
+
+// Get the context table index of an entry.
+uint64_t value_predictor_t::get_ctx_index(const vp_entry_t &m_entry) const {
+    uint64_t hash = (m_entry.context ^ (m_entry.pc >> 2) ^ (uint64_t(m_entry.tid) << 48)) *
+                    0x9e3779b97f4a7c15ull;
+    return (hash >> 32) & (ctx_entries.size() - 1);
+}
+
+// Predict the value of a load, and return false if it is not confident.
+bool value_predictor_t::predict(inst_t *m_inst, int64_t &m_value) {
+    const vp_entry_t &entry = get_entry(m_inst);
+    if((entry.pc != m_inst->pc) || (entry.tid != m_inst->tid)) { return false; }
+    unsigned conf = entry.conf;
+    switch(type) {
+        case vp_last:   { m_value = entry.last; break; }
+        case vp_stride: { m_value = entry.last + entry.stride; break; }
+        default:        { const vp_ctx_entry_t &ctx_entry = ctx_entries[get_ctx_index(entry)];
+                          m_value = ctx_entry.value; conf = ctx_entry.conf; break; }
+    }
+    return conf >= threshold;
+}
+
+// Train the predictor with the loaded value, and check the prediction.
+void value_predictor_t::update(inst_t *m_inst) {
+    int64_t value = m_inst->rd_val;
+    bool correct = m_inst->val_predicted && (m_inst->pred_val == value);
+    // Update the stats of the thread and PC.
+    pair<unsigned, uint64_t> key(m_inst->tid, m_inst->pc);
+    map<pair<unsigned, uint64_t>, vp_pc_stats_t>::iterator it = pc_stats.find(key);
+    if(it == pc_stats.end()) {
+        vp_pc_stats_t stats = { get_inst_str(m_inst), 0, 0, 0 };
+        it = pc_stats.insert(make_pair(key, stats)).first;
+    }
+    it->second.loads++;
+    it->second.predicts += m_inst->val_predicted;
+    it->second.correct  += correct;
+    num_loads++;
+    num_predicts += m_inst->val_predicted;
+    num_correct  += correct;
+    num_speculated += m_inst->val_speculated;
+    num_squashes   += m_inst->val_speculated && !correct;
+
+    // Allocate the entry to a new load.
+    vp_entry_t &entry = get_entry(m_inst);
+    if((entry.pc != m_inst->pc) || (entry.tid != m_inst->tid)) {
+        entry.pc      = m_inst->pc;
+        entry.tid     = m_inst->tid;
+        entry.last    = value;
+        entry.stride  = 0;
+        entry.context = fold_value(value);
+        entry.conf    = 0;
+        return;
+    }
+    switch(type) {
+        case vp_last:   { update_conf(entry.conf, value == entry.last); break; }
+        case vp_stride: { update_conf(entry.conf, value == entry.last + entry.stride);
+                          entry.stride = value - entry.last; break; }
+        default:        { vp_ctx_entry_t &ctx_entry = ctx_entries[get_ctx_index(entry)];
+                          update_conf(ctx_entry.conf, value == ctx_entry.value);
+                          ctx_entry.value = value;
+                          entry.context = (entry.context << vp_ctx_shift) ^ fold_value(value);
+                          break; }
+    }
+    entry.last = value;
+}
+
+// Print value prediction stats.
+void value_predictor_t::print_stats() {
+    cout << endl << "Load value prediction stats:" << endl;
+    cout.precision(3);
+    cout << "    Number of loads = " << num_loads << endl;
+    cout << "    Coverage = " << fixed
+         << (num_loads ? double(num_predicts) / double(num_loads) : 0)
+         << " (" << num_predicts << "/" << num_loads << ")" << endl;
+    cout << "    Accuracy = " << fixed
+         << (num_predicts ? double(num_correct) / double(num_predicts) : 0)
+         << " (" << num_correct << "/" << num_predicts << ")" << endl;
+    cout << "    Predicted values given to dependents = " << num_speculated << endl;
+    cout << "    Value mispredictions squashed = " << num_squashes << endl;
+    // Print the loads with the most executions. The thread is printed if
+    // loads of multiple threads ran.
+    if(pc_stats.size()) {
+        vector<pair<uint64_t, pair<unsigned, uint64_t> > > pcs;
+        bool multi_thread = false;
+        for(map<pair<unsigned, uint64_t>, vp_pc_stats_t>::iterator it = pc_stats.begin();
+            it != pc_stats.end(); it++) {
+            pcs.push_back(make_pair(it->second.loads, it->first));
+            multi_thread |= (it->first.first != 0);
+        }
+        sort(pcs.begin(), pcs.end(), greater<pair<uint64_t, pair<unsigned, uint64_t> > >());
+        cout << "    Loads by PC (top " << min(pcs.size(), size_t(10)) << "):" << endl;
+        for(size_t i = 0; (i < pcs.size()) && (i < 10); i++) {
+            const vp_pc_stats_t &stats = pc_stats[pcs[i].second];
+            cout << "        [";
+            if(multi_thread) { cout << "tid=" << pcs[i].second.first << ", "; }
+            cout << "pc=" << pcs[i].second.second << "] " << stats.inst_str
+                 << " = " << stats.loads << ", coverage = " << fixed
+                 << double(stats.predicts) / double(stats.loads) << ", accuracy = "
+                 << (stats.predicts ? double(stats.correct) / double(stats.predicts) : 0) << endl;
+        }
+    }
+    cout.precision(-1);
+}
+
+// Register value prediction stats.
+void value_predictor_t::register_stats(stats_t *m_stats, const string &m_prefix) {
+    m_stats->add_counter(m_prefix + ".loads", &num_loads, "Number of loads");
+    m_stats->add_counter(m_prefix + ".predicts", &num_predicts, "Number of confident predictions");
+    m_stats->add_counter(m_prefix + ".correct", &num_correct, "Number of correct predictions");
+    m_stats->add_counter(m_prefix + ".speculated", &num_speculated,
+                         "Number of predicted values given to dependents");
+    m_stats->add_counter(m_prefix + ".squashes", &num_squashes,
+                         "Number of mispredicted values given to dependents");
+    m_stats->add_formula(m_prefix + ".coverage", m_prefix + ".predicts", m_prefix + ".loads",
+                         "Fraction of loads with a confident prediction");
+    m_stats->add_formula(m_prefix + ".accuracy", m_prefix + ".correct", m_prefix + ".predicts",
+                         "Fraction of confident predictions that are correct");
+}
+
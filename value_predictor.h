@@ -0,0 +1,81 @@
+#ifndef __KITE_VALUE_PREDICTOR_H__
+#define __KITE_VALUE_PREDICTOR_H__
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+#include "inst.h"
+
+class stats_t;
+
+// Load value predictor types
+enum vp_type {
+    vp_last = 0,                            // Last value of the load
+    vp_stride,                              // Last value plus the last stride
+    vp_context,                             // Value that followed the same recent values
+};
+
+// A context is a hash of the recent values of a load. Each value is folded
+// into vp_ctx_shift bits, and older values are shifted out.
+#define vp_ctx_shift        16
+#define vp_max_confidence   15
+
+// Value prediction table entry
+struct vp_entry_t {
+    uint64_t pc;                            // PC of the load (0 if invalid)
+    unsigned tid;                           // Thread of the load
+    int64_t last;                           // Last value
+    int64_t stride;                         // Difference of the last two values
+    uint64_t context;                       // Hash of the recent values
+    unsigned conf;                          // Confidence counter
+};
+
+// Context table entry
+struct vp_ctx_entry_t {
+    int64_t value;                          // Value that followed the context
+    unsigned conf;                          // Confidence counter
+};
+
+// Value prediction stats of a PC
+struct vp_pc_stats_t {
+    std::string inst_str;                   // Instruction string
+    uint64_t loads;                         // Number of loads
+    uint64_t predicts;                      // Number of confident predictions
+    uint64_t correct;                       // Number of correct predictions
+};
+
+// Load value predictor. A load is predicted if its entry has seen the
+// predicted pattern at least m_threshold times in a row. Entries are tagged
+// with the thread and PC of a load.
+class value_predictor_t {
+public:
+    value_predictor_t(vp_type m_type, uint64_t m_entries, unsigned m_threshold);
+    ~value_predictor_t();
+
+    // Predict the value of a load, and return false if it is not confident.
+    bool predict(inst_t *m_inst, int64_t &m_value);
+    void update(inst_t *m_inst);            // Train the predictor with the loaded value.
+    void print_stats();                     // Print value prediction stats.
+    void register_stats(stats_t *m_stats, const std::string &m_prefix);    // Register stats.
+
+private:
+    vp_entry_t &get_entry(const inst_t *m_inst);                // Get the entry of a load.
+    uint64_t get_ctx_index(const vp_entry_t &m_entry) const;  // Get the context table index.
+
+    vp_type type;                           // Predictor type
+    std::vector<vp_entry_t> entries;        // Value prediction table indexed by PC
+    std::vector<vp_ctx_entry_t> ctx_entries;    // Context table indexed by PC and context
+    unsigned threshold;                     // Confidence threshold to predict
+
+    // Stats
+    uint64_t num_loads;                     // Number of loads
+    uint64_t num_predicts;                  // Number of confident predictions
+    uint64_t num_correct;                   // Number of correct predictions
+    uint64_t num_speculated;                // Number of predicted values given to dependents
+    uint64_t num_squashes;                  // Number of mispredicted values given to dependents
+    std::map<std::pair<unsigned, uint64_t>, vp_pc_stats_t> pc_stats;  // Stats per thread and PC
+};
+
+#endif
+
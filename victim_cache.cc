@@ -0,0 +1,95 @@
+#include <iostream>
+#include "stats.h"
+#include "victim_cache.h"
+
+using namespace std;
+
+victim_cache_t::victim_cache_t(uint64_t m_num_entries, uint64_t m_latency) :
+    num_entries(m_num_entries),
+    latency(m_latency),
+    addrs(0),
+    data(0),
+    valid(0),
+    dirty(0),
+    inserted(0),
+    num_inserts(0),
+    num_probes(0),
+    num_hits(0),
+    num_writebacks(0) {
+    // Allocate fully-associative victim entries.
+    addrs    = new uint64_t[num_entries]();
+    data     = new int64_t*[num_entries]();
+    valid    = new bool[num_entries]();
+    dirty    = new bool[num_entries]();
+    inserted = new uint64_t[num_entries]();
+}
+
+victim_cache_t::~victim_cache_t() {
+    // Deallocate the victim entries.
+    delete [] addrs;
+    delete [] data;
+    delete [] valid;
+    delete [] dirty;
+    delete [] inserted;
+}
+
+// Probe a block. A hit removes the block from the victim cache so that it is
+// swapped with a block evicted from the cache when the hit block is placed.
+int64_t* victim_cache_t::probe(uint64_t m_addr, bool &m_dirty) {
+    num_probes++;
+    for(uint64_t i = 0; i < num_entries; i++) {
+        if(valid[i] && (addrs[i] == m_addr)) {
+            valid[i] = false;
+            m_dirty = dirty[i];
+            num_hits++;
+            return data[i];
+        }
+    }
+    return 0;
+}
+
+// Insert a block evicted from the cache. The oldest entry is replaced if the
+// victim cache is full, and return true if the replaced block is dirty.
+bool victim_cache_t::insert(uint64_t m_addr, int64_t *m_data, bool m_dirty,
+                            uint64_t &m_writeback_addr) {
+    uint64_t entry = 0;
+    for(uint64_t i = 0; i < num_entries; i++) {
+        if(!valid[i]) { entry = i; break; }
+        if(inserted[i] < inserted[entry]) { entry = i; }
+    }
+    bool writeback = valid[entry] && dirty[entry];
+    if(writeback) {
+        num_writebacks++;
+        m_writeback_addr = addrs[entry];
+    }
+    // Place the evicted block.
+    addrs[entry]    = m_addr;
+    data[entry]     = m_data;
+    valid[entry]    = true;
+    dirty[entry]    = m_dirty;
+    inserted[entry] = ++num_inserts;
+    return writeback;
+}
+
+// Get the hit latency.
+uint64_t victim_cache_t::get_latency() const { return latency; }
+
+// Print victim cache stats.
+void victim_cache_t::print_stats() {
+    cout << endl << "Victim cache stats:" << endl;
+    cout.precision(3);
+    cout << "    Number of entries = " << num_entries << endl;
+    cout << "    Number of writebacks = " << num_writebacks << endl;
+    cout << "    Hit rate = " << fixed
+         << (num_probes ? double(num_hits) / double(num_probes) : 0)
+         << " (" << num_hits << "/" << num_probes << ")" << endl;
+    cout.precision(-1);
+}
+// Register victim cache stats.
+void victim_cache_t::register_stats(stats_t *m_stats, const string &m_prefix) {
+    m_stats->add_counter(m_prefix + ".probes", &num_probes, "Number of probes");
+    m_stats->add_counter(m_prefix + ".hits", &num_hits, "Number of hits");
+    m_stats->add_counter(m_prefix + ".writebacks", &num_writebacks, "Number of writebacks");
+    m_stats->add_formula(m_prefix + ".hit_rate", m_prefix + ".hits", m_prefix + ".probes", "Hit rate");
+}
+
@@ -0,0 +1,39 @@
+#ifndef __KITE_VICTIM_CACHE_H__
+#define __KITE_VICTIM_CACHE_H__
+
+#include <cstdint>
+#include <string>
+
+class stats_t;
+
+// Victim cache
+class victim_cache_t {
+public:
+    victim_cache_t(uint64_t m_num_entries, uint64_t m_latency = 1);
+    ~victim_cache_t();
+
+    // Probe a block, and remove it from the victim cache on hit.
+    int64_t* probe(uint64_t m_addr, bool &m_dirty);
+    // Insert a block evicted from the cache, and return true if a dirty block is written back.
+    bool insert(uint64_t m_addr, int64_t *m_data, bool m_dirty, uint64_t &m_writeback_addr);
+    uint64_t get_latency() const;               // Get the hit latency.
+    void print_stats();                         // Print victim cache stats.
+    void register_stats(stats_t *m_stats, const std::string &m_prefix);   // Register stats.
+
+private:
+    uint64_t num_entries;                       // Number of entries
+    uint64_t latency;                           // Hit latency
+    uint64_t *addrs;                            // Block addresses
+    int64_t **data;                             // Block data
+    bool *valid;                                // Valid flags
+    bool *dirty;                                // Dirty flags
+    uint64_t *inserted;                         // Insertion order for replacement
+    uint64_t num_inserts;                       // Number of inserted blocks
+
+    uint64_t num_probes;                        // Number of probes
+    uint64_t num_hits;                          // Number of hits
+    uint64_t num_writebacks;                    // Number of writebacks
+};
+
+#endif
+